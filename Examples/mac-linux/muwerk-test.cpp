@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <iostream>
 #include <list>
 #include <string>
 
+#include <math.h>
 #include <stdio.h>
 #include <time.h>
 
@@ -9,12 +11,103 @@
 
 #include "ustd_platform.h"
 
+#include <sys/stat.h>
+
+// LittleFS replacement on the host filesystem for the TimeSeriesStore tests
+#define USTD_FEATURE_FILESYSTEM
+#define TEST_FSROOT "/tmp/muwerk-test-fs"
+
+enum { FS_OK, FS_OPEN_FAILS, FS_WRITES_SHORT } testFsState = FS_OK;
+
+namespace fs {
+class File {
+  public:
+    FILE *fp;
+    File(int _ = 0) : fp(nullptr) {
+    }
+    File(FILE *fp) : fp(fp) {
+    }
+    operator bool() const {
+        return fp != nullptr;
+    }
+    size_t size() {
+        long pos = ftell(fp);
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, pos, SEEK_SET);
+        return size;
+    }
+    bool seek(size_t pos) {
+        return fseek(fp, pos, SEEK_SET) == 0;
+    }
+    size_t read(uint8_t *buf, size_t len) {
+        return fread(buf, 1, len, fp);
+    }
+    size_t write(const uint8_t *buf, size_t len) {
+        return fwrite(buf, 1, testFsState == FS_WRITES_SHORT ? len / 2 : len, fp);
+    }
+    void close() {
+        if (fp) {
+            fclose(fp);
+        }
+        fp = nullptr;
+    }
+};
+class Dir {
+  public:
+    Dir(int _) {
+    }
+};
+}  // namespace fs
+
+class TestFS {
+  public:
+    bool begin() {
+        mkdir(TEST_FSROOT, 0755);
+        return true;
+    }
+    void end() {
+    }
+    bool remove(String filename) {
+        return ::remove(path(filename).c_str()) == 0;
+    }
+    bool exists(String filename) {
+        struct stat st;
+        return stat(path(filename).c_str(), &st) == 0;
+    }
+    bool rename(String from, String to) {
+        return ::rename(path(from).c_str(), path(to).c_str()) == 0;
+    }
+    fs::File open(const char *filename, const char *mode) {
+        if (testFsState == FS_OPEN_FAILS) {
+            return fs::File();
+        }
+        return fs::File(fopen(path(filename).c_str(), mode));
+    }
+    fs::Dir openDir(const char *_) {
+        return fs::Dir(0);
+    }
+
+  private:
+    static String path(String filename) {
+        return String(TEST_FSROOT) + filename;
+    }
+} LittleFS;
+
 #include "ustd_array.h"
 #include "ustd_map.h"
 #include "ustd_queue.h"
 
 #include "scheduler.h"
 #include "sensors.h"
+#include "sensorpipeline.h"
+#include "sensorhistory.h"
+#include "timeseries.h"
+#include "thresholddetector.h"
+#include "decimators.h"
+#include "spectrum.h"
+#include "msgpack.h"
+#include "jsonmap.h"
 
 using std::cout;
 using std::endl;
@@ -135,6 +228,1256 @@ void numericTests() {
     }
 }
 
+int numericGridTests() {
+    int errs = 0;
+    // uniformly spaced points are used directly by the grid
+    const float cx[] = {0., 1., 2., 3.}, cy[] = {9, 3, 2.8, 1};
+    ustd::numericFunction<float> f(cx, cy, sizeof(cx) / sizeof(float), false);
+    ustd::numericFunction<float> g(cx, cy, sizeof(cx) / sizeof(float), false);
+    g.compileGrid();
+    double maxErr = 0.0;
+    for (int ix = 0; ix < 100; ix++) {
+        float xi = (float)ix / 10.0 - 3.0;
+        float err = fabs(f(xi) - g(xi));
+        if (err > maxErr)
+            maxErr = err;
+    }
+    printf("numericFunction uniform grid: %d intervals, error bound %f, max error %f\n", g.gridLen,
+           g.gridError, maxErr);
+    if (g.gridLen != 3 || maxErr > 1e-5) {
+        printf("Numeric function grid test failed!\n");
+        ++errs;
+    }
+
+    // non-uniform calibration curve, resampled
+    const int np = 100;
+    double px[np], py[np];
+    for (int i = 0; i < np; i++) {
+        px[i] = (double)(i * i) / 10.0;
+        py[i] = sqrt(px[i] + 1.0) * 3.0;
+    }
+    ustd::numericFunction<double> h(px, py, np);
+    ustd::numericFunction<double> hg(px, py, np);
+    hg.compileGrid(4096);
+    const int n = 100000;
+    double sum1 = 0.0, sum2 = 0.0;
+    maxErr = 0.0;
+    unsigned long t0 = micros();
+    for (int i = 0; i < n; i++) {
+        sum1 += h((double)i * 0.01);
+    }
+    unsigned long t1 = micros();
+    for (int i = 0; i < n; i++) {
+        sum2 += hg((double)i * 0.01);
+    }
+    unsigned long t2 = micros();
+    for (int i = 0; i < n; i++) {
+        double err = fabs(h((double)i * 0.01) - hg((double)i * 0.01));
+        if (err > maxErr)
+            maxErr = err;
+    }
+    printf("numericFunction %d points, %d evaluations: search %ld us, grid(%d) %ld us, error "
+           "bound %f, max error %f\n",
+           np, n, ustd::timeDiff(t0, t1), hg.gridLen, ustd::timeDiff(t1, t2), hg.gridError, maxErr);
+    if (maxErr > hg.gridError + 1e-6) {
+        printf("Numeric function grid error bound test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+double testSignal(int i) {
+    // deterministic slowly changing signal with noise in [-0.5, 0.5]
+    static unsigned long lcg = 12345;
+    lcg = lcg * 1103515245 + 12345;
+    double noise = (double)((lcg >> 16) & 0x7fff) / 32767.0 - 0.5;
+    return 20.0 + 5.0 * sin((double)i / 50.0) + noise;
+}
+
+constexpr float ccx[] = {0., 1., 2., 3.}, ccy[] = {9, 3, 2.8, 1};
+static_assert(ustd::constNumericFunction<float>::isMonotone(ccx, ccy, 4), "Table not monotone");
+constexpr float cbx[] = {0., 1., 1., 3.};
+static_assert(ustd::constNumericFunction<float>::validLength(cbx, ccy, 4) == 2, "Prefix wrong");
+
+double sinApproxError(int points, bool spline) {
+    // max error of approximating sin(x) on [0, pi/2] with a numericFunction
+    const double pi2 = 1.5707963267948966;
+    double px[64], py[64], err = 0.0;
+    for (int i = 0; i < points; i++) {
+        px[i] = pi2 * i / (points - 1);
+        py[i] = sin(px[i]);
+    }
+    ustd::numericFunction<double> f(px, py, points, false, spline);
+    for (int i = 0; i <= 1000; i++) {
+        double xi = pi2 * i / 1000.0;
+        err = fmax(err, fabs(f(xi) - sin(xi)));
+    }
+    return err;
+}
+
+int numericSplineTests() {
+    int errs = 0;
+    double errLin16 = sinApproxError(16, false);
+    double errSpl16 = sinApproxError(16, true);
+    double errLin50 = sinApproxError(50, false);
+    printf("numericFunction sin approximation max error: linear/16 %g, spline/16 %g, linear/50 "
+           "%g\n",
+           errLin16, errSpl16, errLin50);
+    if (errSpl16 > errLin50) {
+        printf("Numeric function spline accuracy test failed!\n");
+        ++errs;
+    }
+    // monotone data with a sharp step must not overshoot
+    const double sx[] = {0., 1., 2., 3., 4.}, sy[] = {0., 0.01, 1., 1.01, 1.02};
+    ustd::numericFunction<double> step(sx, sy, 5, false, true);
+    for (int i = 0; i <= 400; i++) {
+        double ys = step((double)i / 100.0);
+        if (ys < 0.0 || ys > 1.02) {
+            printf("Numeric function spline overshoot at %f: %f\n", (double)i / 100.0, ys);
+            ++errs;
+            break;
+        }
+    }
+    return errs;
+}
+
+int numericBatchTests() {
+    int errs = 0;
+    const int np = 100;
+    double px[np], py[np];
+    for (int i = 0; i < np; i++) {
+        px[i] = (double)(i * i) / 10.0;
+        py[i] = sqrt(px[i] + 1.0) * 3.0;
+    }
+    const int n = 100000;
+    double *xs = new double[n];
+    double *ys = new double[n];
+    double *ref = new double[n];
+    for (int spline = 0; spline < 2; spline++) {
+        ustd::numericFunction<double> f(px, py, np, true, spline == 1);
+        for (int sorted = 1; sorted >= 0; sorted--) {
+            for (int i = 0; i < n; i++) {
+                xs[i] = sorted ? (double)i * 0.01 - 10.0 : fmod((double)i * 7919.0 * 0.01, 1000.0);
+            }
+            unsigned long t0 = micros();
+            for (int i = 0; i < n; i++) {
+                ref[i] = f(xs[i]);
+            }
+            unsigned long t1 = micros();
+            f.evaluate(xs, ys, n);
+            unsigned long t2 = micros();
+            double maxErr = 0.0;
+            for (int i = 0; i < n; i++) {
+                maxErr = fmax(maxErr, fabs(ref[i] - ys[i]));
+            }
+            printf("numericFunction %s %s evaluation of %d values: per element %ld us, batch %ld "
+                   "us, max error %g\n",
+                   spline ? "spline" : "linear", sorted ? "sorted" : "unsorted", n,
+                   ustd::timeDiff(t0, t1), ustd::timeDiff(t1, t2), maxErr);
+            if (maxErr > 1e-9) {
+                printf("Numeric function batch evaluation test failed!\n");
+                ++errs;
+            }
+        }
+    }
+    delete[] xs;
+    delete[] ys;
+    delete[] ref;
+    return errs;
+}
+
+int numericViewTests() {
+    int errs = 0;
+    float cx[] = {0., 1., 2., 3.}, cy[] = {9, 3, 2.8, 1};
+    ustd::numericFunction<float> f(cx, cy, 4);
+    ustd::numericFunctionView<float> v(cx, cy, 4);
+    f.rescaleX(10.0, 40.0);
+    f.rescaleY(0.0, 1.0);
+    v.rescaleX(10.0, 40.0);
+    v.rescaleY(0.0, 1.0);
+    double maxErr = 0.0;
+    for (int ix = 0; ix <= 50; ix++) {
+        float xi = (float)ix;
+        maxErr = fmax(maxErr, fabs(f(xi) - v(xi)));
+    }
+    printf("numericFunction rescaled: x %f..%f, y %f..%f, view: x %f..%f, max error %f\n", f.minX,
+           f.maxX, f.minY, f.maxY, v.minX(), v.maxX(), maxErr);
+    if (maxErr > 1e-5 || f.minX != 10.0 || f.maxX != 40.0 || f.minY != 0.0 || f.maxY != 1.0 ||
+        ustd::numericFunction<float>::min(cx, 4) != 10.0 || cy[0] != 1.0) {
+        printf("Numeric function rescale/view test failed!\n");
+        ++errs;
+    }
+    // const arrays
+    ustd::array<float> ar;
+    for (unsigned int i = 0; i < 4; i++) {
+        ar[i] = cy[i];
+    }
+    const ustd::array<float> &car = ar;
+    if (ustd::numericFunction<float>::min(car) != 0.0 ||
+        ustd::numericFunction<float>::max(car) != 1.0) {
+        printf("Numeric function const array min/max test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int constNumericTests() {
+    int errs = 0;
+    constexpr ustd::constNumericFunction<float> cf(ccx, ccy, 4, true);
+    static_assert(cf.minX() == 0 && cf.maxX() == 3 && cf.minY() == 1 && cf.maxY() == 9,
+                  "Range not constant");
+    ustd::numericFunction<float> f(ccx, ccy, 4, true);
+    double maxErr = 0.0;
+    // numericFunction and constNumericFunction must agree up to maxX
+    for (int ix = 0; ix < 60; ix++) {
+        float xi = (float)ix / 10.0 - 3.0;
+        double err = fabs(f(xi) - cf(xi));
+        if (err > maxErr)
+            maxErr = err;
+    }
+    printf("constNumericFunction: len %d, x %f..%f, y %f..%f, max error %f\n", cf.len, cf.minX(),
+           cf.maxX(), cf.minY(), cf.maxY(), maxErr);
+    if (maxErr > 1e-5 || cf.minY() != 1.0 || cf.maxY() != 9.0) {
+        printf("Const numeric function test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int sensorTests() {
+    int errs = 0;
+    const int n = 20000;
+    double *samples = new double[n];
+    long *lsamples = new long[n];
+    for (int i = 0; i < n; i++) {
+        samples[i] = testSignal(i);
+        lsamples[i] = (long)(samples[i] * 100.0);
+    }
+
+    // accuracy: double vs. fixed-point sensorprocessor
+    ustd::sensorprocessor sp(10, 0, 0.1);
+    ustd::fixedsensorprocessor<> fsp(10, 0, 0.1);
+    double maxErr = 0.0;
+    int spReadings = 0, fspReadings = 0;
+    for (int i = 0; i < n; i++) {
+        double v1 = samples[i], v2 = samples[i];
+        if (sp.filter(&v1))
+            ++spReadings;
+        if (fsp.filter(&v2))
+            ++fspReadings;
+        double err = fabs(sp.meanVal - ustd::fixedsensorprocessor<>::toDouble(fsp.meanVal));
+        if (err > maxErr)
+            maxErr = err;
+    }
+    printf("sensorprocessor double vs. fixed: max error %f, readings %d vs. %d\n", maxErr,
+           spReadings, fspReadings);
+    if (maxErr > 0.001) {
+        printf("Fixed-point sensorprocessor accuracy test failed!\n");
+        ++errs;
+    }
+
+    // benchmark: long integer interface of both implementations
+    ustd::sensorprocessor bsp(10, 0, 1.0);
+    ustd::fixedsensorprocessor<> bfsp(10, 0, 1.0);
+    long sink = 0;
+    unsigned long t0 = micros();
+    for (int i = 0; i < n; i++) {
+        long v = lsamples[i];
+        if (bsp.filter(&v))
+            sink += v;
+    }
+    unsigned long t1 = micros();
+    for (int i = 0; i < n; i++) {
+        long v = lsamples[i];
+        if (bfsp.filter(&v))
+            sink -= v;
+    }
+    unsigned long t2 = micros();
+    printf("sensorprocessor %d samples: double %ld us, fixed %ld us (checksum %ld)\n", n,
+           ustd::timeDiff(t0, t1), ustd::timeDiff(t1, t2), sink);
+
+    delete[] samples;
+    delete[] lsamples;
+    return errs;
+}
+
+int sensorbankTests() {
+    int errs = 0;
+    const int channels = 64;
+    const int ticks = 2000;
+    double *samples = new double[channels * ticks];
+    for (int t = 0; t < ticks; t++) {
+        for (int c = 0; c < channels; c++) {
+            samples[t * channels + c] = testSignal(t + c * 7) * (1.0 + c / 10.0);
+        }
+    }
+
+    // sensorbank must produce the same readings as individual sensorprocessors
+    ustd::sensorbank<channels> bank(10, 0, 0.1);
+    ustd::sensorprocessor *sps = new ustd::sensorprocessor[channels];
+    for (int c = 0; c < channels; c++) {
+        sps[c].update(10, 0, 0.1);
+    }
+    uint32_t mask[ustd::sensorbank<channels>::maskWords];
+    double values[channels];
+    int mismatches = 0;
+    double maxErr = 0.0;
+    for (int t = 0; t < ticks; t++) {
+        for (int c = 0; c < channels; c++) {
+            values[c] = samples[t * channels + c];
+        }
+        bank.filter(values, mask);
+        for (int c = 0; c < channels; c++) {
+            double v = samples[t * channels + c];
+            bool ref = sps[c].filter(&v);
+            if (ref != ustd::sensorbank<channels>::isSet(mask, c))
+                ++mismatches;
+            double err = fabs(sps[c].meanVal - bank.meanVal[c]);
+            if (err > maxErr)
+                maxErr = err;
+        }
+    }
+    printf("sensorbank vs. sensorprocessor: %d mismatches, max error %g\n", mismatches, maxErr);
+    if (mismatches > 0 || maxErr > 1e-9) {
+        printf("Sensorbank test failed!\n");
+        ++errs;
+    }
+
+    // benchmark: one pass over all channels vs. one object per channel
+    double sink = 0.0;
+    unsigned long t0 = micros();
+    for (int t = 0; t < ticks; t++) {
+        for (int c = 0; c < channels; c++) {
+            double v = samples[t * channels + c];
+            if (sps[c].filter(&v))
+                sink += v;
+        }
+    }
+    unsigned long t1 = micros();
+    for (int t = 0; t < ticks; t++) {
+        for (int c = 0; c < channels; c++) {
+            values[c] = samples[t * channels + c];
+        }
+        if (bank.filter(values, mask))
+            sink -= values[0];
+    }
+    unsigned long t2 = micros();
+    printf("%d channels x %d ticks: sensorprocessors %ld us, sensorbank %ld us (%g)\n", channels,
+           ticks, ustd::timeDiff(t0, t1), ustd::timeDiff(t1, t2), sink);
+
+    delete[] sps;
+    delete[] samples;
+    return errs;
+}
+
+int filterEngineTests() {
+    int errs = 0;
+    const int n = 5000;
+    const unsigned int w = 9;
+    ustd::medianFilter<w> med;
+    ustd::movingAverageFilter<w> avg;
+    double window[w];
+    int medErrs = 0;
+    double maxAvgErr = 0.0;
+    for (int i = 0; i < n; i++) {
+        double v = testSignal(i);
+        if (i % 17 == 0)
+            v += 1000.0;  // spikes
+        window[i % w] = v;
+        int cnt = i < (int)w ? i + 1 : w;
+        double sorted[w], sum = 0.0;
+        for (int j = 0; j < cnt; j++) {
+            sorted[j] = window[j];
+            sum += window[j];
+        }
+        std::sort(sorted, sorted + cnt);
+        double vm = v, va = v;
+        med.filter(&vm);
+        avg.filter(&va);
+        // even counts may return either middle value
+        if (vm != sorted[cnt / 2] && vm != sorted[(cnt - 1) / 2])
+            ++medErrs;
+        if (fabs(va - sum / cnt) > maxAvgErr)
+            maxAvgErr = fabs(va - sum / cnt);
+    }
+    printf("medianFilter: %d errors, movingAverageFilter: max error %g\n", medErrs, maxAvgErr);
+    if (medErrs || maxAvgErr > 1e-9) {
+        printf("Filter engine test failed!\n");
+        ++errs;
+    }
+
+    ustd::kalmanFilter<double> kal(0.0001, 0.25);
+    double kv = 0.0;
+    for (int i = 0; i < n; i++) {
+        kv = 10.0 + testSignal(i) - testSignal(i + 1);  // noisy constant
+        kal.filter(&kv);
+    }
+    printf("kalmanFilter estimate of constant 10.0: %f\n", kv);
+    if (fabs(kv - 10.0) > 0.2) {
+        printf("Kalman filter test failed!\n");
+        ++errs;
+    }
+
+    // sensorfilter with exponentialFilter must behave like sensorprocessor
+    ustd::sensorfilter<ustd::exponentialFilter<>> sf(ustd::exponentialFilter<>(10), 0, 0.1);
+    ustd::sensorprocessor sp(10, 0, 0.1);
+    int mismatches = 0;
+    for (int i = 0; i < n; i++) {
+        double v1 = testSignal(i), v2 = v1;
+        if (sf.filter(&v1) != sp.filter(&v2) || v1 != v2)
+            ++mismatches;
+    }
+    printf("sensorfilter<exponentialFilter> vs. sensorprocessor: %d mismatches\n", mismatches);
+    if (mismatches) {
+        printf("Sensorfilter test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int sensorPipelineTests() {
+    int errs = 0;
+    ustd::Scheduler psched(4, 16, 4);
+    int raw = 0;
+    const double cx[] = {0., 100.}, cy[] = {0., 1000.};
+    ustd::numericFunction<double> calibration(cx, cy, 2);
+    ustd::sensorprocessor filter(1, 0, 0.5);
+    ustd::SensorPipeline<> pipe(
+        "pipe",
+        [&raw](double *pValue) {
+            *pValue = (double)(raw++ / 10);  // changes every 10th read
+            return true;
+        },
+        &filter, &calibration);
+    pipe.begin(&psched, 1000L);
+    int msgs = 0;
+    String lastMsg, stats;
+    psched.subscribe(SCHEDULER_MAIN, "pipe/value", [&](String topic, String msg, String orig) {
+        ++msgs;
+        lastMsg = msg;
+    });
+    psched.subscribe(SCHEDULER_MAIN, "pipe/pipeline",
+                     [&](String topic, String msg, String orig) { stats = msg; });
+    while (pipe.reads < 100) {
+        psched.loop();
+    }
+    psched.publish("pipe/pipeline/get");
+    psched.loop();
+    printf("SensorPipeline: %ld reads, %ld publishes, %d messages, last: %s, stats: %s\n",
+           pipe.reads, pipe.publishes, msgs, lastMsg.c_str(), stats.c_str());
+    if (msgs < 9 || msgs > 11 || stats == "") {
+        printf("Sensor pipeline test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int sensorHistoryTests() {
+    int errs = 0;
+    ustd::Scheduler hsched(4, 16, 4);
+    ustd::SensorHistory<10, 30, 4> history("hist");
+    typedef ustd::SensorHistory<10, 30, 4> T_HIST;
+    history.begin(&hsched, "hist/value");
+    // three hours of one value every 10 seconds, starting at an hour boundary
+    for (uint32_t t = 3600; t < 4 * 3600; t += 10) {
+        history.add((float)((t / 60) % 60), t);
+    }
+    T_HIST::Bucket b = {};
+    if (history.size(T_HIST::RAW) != 10 || history.size(T_HIST::MINUTE) != 30 ||
+        history.size(T_HIST::HOUR) != 2) {
+        printf("SensorHistory: wrong sizes %u %u %u\n", history.size(T_HIST::RAW),
+               history.size(T_HIST::MINUTE), history.size(T_HIST::HOUR));
+        ++errs;
+    }
+    history.get(T_HIST::MINUTE, 29, &b);
+    if (b.t != 4 * 3600 - 120 || b.count != 6 || b.minVal != 58 || b.avg() != 58) {
+        printf("SensorHistory: wrong minute bucket t=%u count=%u\n", b.t, b.count);
+        ++errs;
+    }
+    history.get(T_HIST::HOUR, 0, &b);
+    if (b.t != 3600 || b.count != 360 || b.minVal != 0 || b.maxVal != 59 || b.avg() != 29.5) {
+        printf("SensorHistory: wrong hour bucket t=%u count=%u avg=%f\n", b.t, b.count,
+               b.avg());
+        ++errs;
+    }
+    String reply;
+    hsched.subscribe(SCHEDULER_MAIN, "hist/history/hour",
+                     [&](String topic, String msg, String orig) { reply = msg; });
+    hsched.publish("hist/history/get", "hour,7200");
+    hsched.publish("hist/value", "17.5");
+    hsched.loop();
+    printf("SensorHistory: %s\n", reply.c_str());
+    if (reply != "{\"resolution\":\"hour\",\"data\":[[7200,0.000,59.000,29.500]]}") {
+        ++errs;
+    }
+    history.get(T_HIST::RAW, 9, &b);
+    if (b.minVal != 17.5f) {
+        printf("SensorHistory: topic ingestion failed\n");
+        ++errs;
+    }
+    // values that do not fit a fixed point representation or json
+    ustd::SensorHistory<4, 2, 2, double> extreme("extreme");
+    extreme.add(-1e300, 10);
+    extreme.add(1.0 / 0.0, 11);
+    extreme.add(0.0 / 0.0, 12);
+    extreme.add(0.25, 13);
+    String json = extreme.query(ustd::SensorHistory<4, 2, 2, double>::RAW);
+    printf("SensorHistory: %s\n", json.c_str());
+    if (json != "{\"resolution\":\"raw\",\"data\":[[10,-1.000000e+300],[11,null],[12,null],"
+                "[13,0.250]]}") {
+        ++errs;
+    }
+    return errs;
+}
+
+typedef ustd::TimeSeriesStore<128> T_TSSTORE;
+
+unsigned int readStore(T_TSSTORE &store, uint32_t from, uint32_t to, uint32_t *pFirst,
+                       uint32_t *pLast) {
+    // counts the samples in a range and checks that they are consecutive
+    unsigned int count = 0;
+    bool ok = true;
+    store.read(from, to, [&](uint32_t t, float value) {
+        if (count && t != *pLast + 10) {
+            ok = false;
+        }
+        if (value != (float)((t / 10) % 97) * 0.37f) {
+            ok = false;
+        }
+        if (!count) {
+            *pFirst = t;
+        }
+        *pLast = t;
+        ++count;
+    });
+    return ok ? count : 0;
+}
+
+int timeSeriesStoreTests() {
+    int errs = 0;
+    LittleFS.remove("/ts.0");
+    LittleFS.remove("/ts.1");
+    // blocks larger than TIMESERIES_READ_CHUNK are decoded through a window
+    T_TSSTORE store("/ts", 2);
+    store.begin();
+    uint32_t t = 1000, first = 0, last = 0;
+    for (; t < 1000 + 10 * 600; t += 10) {
+        store.add((float)((t / 10) % 97) * 0.37f, t);
+    }
+    unsigned int count = readStore(store, 0, 0xffffffff, &first, &last);
+    unsigned int blocks = 0;
+    for (const char *fn : {"/ts.0", "/ts.1"}) {
+        fs::File f = ustd::fsOpen(fn, "r");
+        if (f) {
+            blocks += f.size() / 128;
+            f.close();
+        }
+    }
+    // rotation keeps between 2 and 4 blocks in the files
+    if (!count || last != t - 10 || first <= 1000 || blocks < 3 || blocks > 4) {
+        printf("TimeSeriesStore: rotation failed, %u samples %u..%u in %u blocks\n", count,
+               first, last, blocks);
+        ++errs;
+    }
+    // time range
+    uint32_t from = first + 200, to = last - 300;
+    if (readStore(store, from, to, &first, &last) != (to - from) / 10 + 1 || first != from ||
+        last != to) {
+        printf("TimeSeriesStore: range read failed\n");
+        ++errs;
+    }
+    // a full block that cannot be written is kept and the sample is rejected, so that adding
+    // it again after the failure continues the series without gaps
+    bool rejected[2] = {false, false};
+    for (int state = 0; state < 2; state++) {
+        testFsState = state ? FS_WRITES_SHORT : FS_OPEN_FAILS;
+        for (int i = 0; i < 100; i++, t += 10) {
+            if (!store.add((float)((t / 10) % 97) * 0.37f, t)) {
+                rejected[state] = true;
+                break;
+            }
+        }
+        testFsState = FS_OK;
+        if (!store.add((float)((t / 10) % 97) * 0.37f, t)) {
+            printf("TimeSeriesStore: retry failed\n");
+            ++errs;
+        }
+        t += 10;
+    }
+    store.flush();
+    unsigned int stored = readStore(store, 0, 0xffffffff, &first, &last);
+    T_TSSTORE reopened("/ts", 2);
+    reopened.begin();
+    if (!rejected[0] || !rejected[1] || !stored || last != t - 10 ||
+        readStore(reopened, 0, 0xffffffff, &first, &last) != stored || last != t - 10) {
+        printf("TimeSeriesStore: write failures not handled, %u samples\n", stored);
+        ++errs;
+    }
+    LittleFS.remove("/ts.0");
+    LittleFS.remove("/ts.1");
+    printf("TimeSeriesStore: %u samples in %u blocks\n", count, blocks);
+    return errs;
+}
+
+int timeSeriesTests() {
+    int errs = 0;
+    ustd::tsBlockEncoder<256> enc;
+    uint32_t ts[256];
+    float vals[256];
+    unsigned int n = 0;
+    uint32_t t = 1600000000;
+    float temp = 21.5f;
+    // temperature with 0.1 resolution sampled every 10 seconds, with occasional jitter
+    while (true) {
+        t += (n % 17 == 5) ? 11 : 10;
+        if (n % 3 == 0) {
+            temp = roundf((temp + (testSignal(n) - 0.5f) * 0.4f) * 10.f) / 10.f;
+        }
+        if (!enc.add(t, temp)) {
+            break;
+        }
+        ts[n] = t;
+        vals[n] = temp;
+        ++n;
+    }
+    ustd::tsBlockDecoder dec(enc.data);
+    uint32_t dt;
+    float dv;
+    unsigned int m = 0;
+    while (dec.next(&dt, &dv)) {
+        if (m >= n || dt != ts[m] || dv != vals[m]) {
+            printf("TimeSeries: decode mismatch at sample %u\n", m);
+            ++errs;
+            break;
+        }
+        ++m;
+    }
+    // decode through a small window, as the store does for blocks in files
+    uint8_t window[32];
+    unsigned int pos = 0, len = sizeof(window), offset = ustd::tsBlockDecoder::headerSize;
+    memcpy(window, enc.data, len);
+    ustd::tsBlockDecoder wdec(window);
+    unsigned int wm = 0;
+    while (true) {
+        if (pos + len < sizeof(enc.data) &&
+            wdec.consumed() + ustd::tsBlockDecoder::maxSampleBytes > len - offset) {
+            pos += offset + wdec.consumed();
+            len = sizeof(window);
+            if (pos + len > sizeof(enc.data)) {
+                len = sizeof(enc.data) - pos;
+            }
+            memcpy(window, enc.data + pos, len);
+            offset = 0;
+            wdec.rebase(window);
+        }
+        if (!wdec.next(&dt, &dv)) {
+            break;
+        }
+        if (wm >= n || dt != ts[wm] || dv != vals[wm]) {
+            printf("TimeSeries: windowed decode mismatch at sample %u\n", wm);
+            ++errs;
+            break;
+        }
+        ++wm;
+    }
+    if (wm != n) {
+        printf("TimeSeries: windowed decode failed\n");
+        ++errs;
+    }
+    printf("TimeSeries: %u samples in %u bytes (%.2f bytes/sample)\n", n, enc.bytes(),
+           (double)enc.bytes() / n);
+    if (m != n || dec.length() != n || n < 80) {
+        printf("TimeSeries: compression test failed\n");
+        ++errs;
+    }
+    // extreme deltas and values
+    ustd::tsBlockEncoder<64> enc2;
+    const uint32_t et[] = {0, 5000, 5001, 100000, 100000, 100100};
+    const float ev[] = {0.f, -1e30f, 1e-30f, 3.14159f, 3.14159f, -0.f};
+    for (unsigned int i = 0; i < 6; i++) {
+        enc2.add(et[i], ev[i]);
+    }
+    ustd::tsBlockDecoder dec2(enc2.data);
+    for (unsigned int i = 0; i < 6; i++) {
+        if (!dec2.next(&dt, &dv) || dt != et[i] || memcmp(&dv, &ev[i], sizeof(float))) {
+            printf("TimeSeries: extreme value mismatch at sample %u\n", i);
+            ++errs;
+            break;
+        }
+    }
+    return errs;
+}
+
+int adaptiveRateTests() {
+    int errs = 0;
+    ustd::Scheduler asched(4, 4, 4);
+    ustd::sensorprocessor proc(1, 0, 0.1);
+    proc.setAdaptiveRate(1000L, 64000L);
+    double raw = 20.0;
+    int tID = asched.add([]() {}, "adaptive", 1000L);
+    // stable signal: exponential back off up to the maximum
+    for (int i = 0; i < 10; i++) {
+        double v = raw;
+        proc.filter(&v);
+        proc.adaptSchedule(&asched, tID);
+    }
+    unsigned long stable = proc.pollInterval();
+    // transient: immediate speed up
+    raw = 25.0;
+    proc.filter(&raw);
+    bool rescheduled = proc.adaptSchedule(&asched, tID);
+    unsigned long transient = proc.pollInterval();
+    printf("Adaptive rate: stable %lu us, transient %lu us\n", stable, transient);
+    if (stable != 64000L || transient != 1000L || !rescheduled ||
+        proc.adaptSchedule(&asched, tID)) {
+        printf("Adaptive rate test failed!\n");
+        ++errs;
+    }
+    // stable signal after the transient: the interval grows back
+    for (int i = 0; i < 10; i++) {
+        double v = raw;
+        proc.filter(&v);
+    }
+    unsigned long recovered = proc.pollInterval();
+    // noise of +/- eps around a constant value must not pin the interval at the minimum
+    ustd::sensorprocessor noisy(16, 0, 0.1);
+    noisy.setAdaptiveRate(1000L, 64000L);
+    for (int i = 0; i < 64; i++) {
+        double v = (i % 2) ? 20.1 : 19.9;
+        noisy.filter(&v);
+    }
+    printf("Adaptive rate: recovered %lu us, noisy %lu us\n", recovered, noisy.pollInterval());
+    if (recovered != 64000L || noisy.pollInterval() != 64000L) {
+        printf("Adaptive rate recovery test failed!\n");
+        ++errs;
+    }
+    // reset restarts at the minimum, without adaptive polling there is no interval
+    proc.reset();
+    ustd::sensorprocessor fixedRate(1, 0, 0.1);
+    fixedRate.reset();
+    if (proc.pollInterval() != 1000L || fixedRate.pollInterval() != 0) {
+        printf("Adaptive rate reset test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int outlierTests() {
+    int errs = 0;
+    ustd::sensorprocessor plain(4, 0, 1.0);
+    ustd::sensorprocessor gated(4, 0, 1.0);
+    if (!gated.setOutlierFilter(7, 3.0)) {
+        printf("Outlier gate: allocation failed\n");
+        return 1;
+    }
+    int plainPubs = 0, gatedPubs = 0;
+    for (int i = 0; i < 200; i++) {
+        double raw = testSignal(i);
+        if (i % 25 == 12) {
+            raw = 1000.0;  // corrupted read
+        }
+        if (i >= 150) {
+            raw += 10.0;  // genuine step must pass the gate
+        }
+        double v1 = raw, v2 = raw;
+        plainPubs += plain.filter(&v1) ? 1 : 0;
+        gatedPubs += gated.filter(&v2) ? 1 : 0;
+    }
+    ustd::sensorprocessor copy = gated;
+    printf("Outlier gate: %d publishes without, %d with gate, %lu outliers, mean %f\n", plainPubs,
+           gatedPubs, gated.outliers, gated.meanVal);
+    double expected = 30.0 + 5.0 * sin(199.0 / 50.0);
+    // 8 corrupted reads and a few samples at the begin of the step are rejected
+    if (gated.outliers < 8 || gated.outliers > 12 || gatedPubs >= plainPubs ||
+        fabs(gated.meanVal - expected) > 1.0 || copy.outliers != gated.outliers) {
+        printf("Outlier gate test failed!\n");
+        ++errs;
+    }
+    // outliers do not suppress the periodic reading of a stable value
+    ustd::sensorprocessor periodic(4, 1, 1.0);
+    periodic.setOutlierFilter(3, 3.0);
+    for (int i = 0; i < 3; i++) {
+        double v = 20.0;
+        periodic.filter(&v);
+    }
+    unsigned long start = millis();
+    while (ustd::timeDiff(start, millis()) < 1100) {
+    }
+    double spike = 1000.0;
+    if (!periodic.filter(&spike) || spike != 20.0 || periodic.outliers != 1) {
+        printf("Outlier gate periodic reading test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int thresholdTests() {
+    int errs = 0;
+    ustd::Scheduler tsched(4, 16, 4);
+    ustd::ThresholdDetector<> high("temp", 30.0, 28.0, 0, "alarm");
+    ustd::ThresholdDetector<> low("temp", 5.0, 7.0, 20, "frost");
+    high.begin(&tsched, "temp/value");
+    low.begin(&tsched);
+    String events;
+    tsched.subscribe(SCHEDULER_MAIN, "temp/+", [&](String topic, String msg, String orig) {
+        if (topic != "temp/value") {
+            events += topic.substr(5) + "=" + msg + " ";
+        }
+    });
+    const double vals[] = {25, 29, 30, 31, 29, 28.5, 28, 31, 27};
+    for (unsigned int i = 0; i < sizeof(vals) / sizeof(double); i++) {
+        tsched.publish("temp/value", std::to_string(vals[i]));
+        tsched.loop();
+    }
+    // frost alarm only after 20ms below the level
+    low.update(4.0);
+    bool early = low.getState();
+    unsigned long start = millis();
+    while (ustd::timeDiff(start, millis()) < 40) {
+        tsched.loop();
+    }
+    low.update(6.0);  // inside hysteresis: stays on
+    low.update(8.0);  // pending off, but returns to on before dwell
+    low.update(4.0);
+    tsched.loop();
+    printf("ThresholdDetector: %s(%lu values)\n", events.c_str(), high.values);
+    if (events != "alarm=on alarm=off alarm=on alarm=off frost=on " || early ||
+        !low.getState() || high.events != 4 || low.events != 1) {
+        printf("ThresholdDetector test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int decimatorTests() {
+    int errs = 0;
+    // DC gain of power of two and other decimation ratios
+    ustd::cicDecimator<16, 3> cic16;
+    ustd::cicDecimator<10, 4> cic10;
+    int16_t dc[160];
+    int32_t out16[11], out10[17];
+    for (int i = 0; i < 160; i++) {
+        dc[i] = -1234;
+    }
+    unsigned int n16 = cic16.process(dc, 160, out16);
+    unsigned int n10 = cic10.process(dc, 160, out10);
+    if (n16 != 10 || n10 != 16 || out16[9] != -1234 || out10[15] != -1234) {
+        printf("CIC decimator DC test failed: %u %u %d %d\n", n16, n10, out16[n16 - 1],
+               out10[n10 - 1]);
+        ++errs;
+    }
+
+    // 4 kHz: 5 Hz signal with 60 Hz and 1100 Hz interference -> 50 Hz
+    ustd::cicDecimator<16, 3> cic;
+    ustd::firDecimator<32, 5, int32_t> fir;
+    fir.designLowpass(20.0 / 250.0);
+    const double fs = 4000.0;
+    int16_t block[400];
+    int32_t mid[26], out[6];
+    double ys[200];
+    unsigned int ny = 0;
+    for (int b = 0; b < 40; b++) {
+        for (int k = 0; k < 400; k++) {
+            double t = (b * 400 + k) / fs;
+            block[k] = (int16_t)(8000.0 * sin(2 * M_PI * 5 * t) + 4000.0 * sin(2 * M_PI * 60 * t) +
+                                 4000.0 * sin(2 * M_PI * 1100 * t));
+        }
+        unsigned int n = cic.process(block, 400, mid);
+        n = fir.process(mid, n, out);
+        for (unsigned int i = 0; i < n; i++) {
+            ys[ny++] = out[i];
+        }
+    }
+    // fit a 5 Hz sinusoid to the settled output and measure the residual
+    double sc = 0, cc = 0;
+    for (unsigned int i = 50; i < ny; i++) {
+        sc += ys[i] * sin(2 * M_PI * 5 * i / 50.0);
+        cc += ys[i] * cos(2 * M_PI * 5 * i / 50.0);
+    }
+    sc *= 2.0 / (ny - 50);
+    cc *= 2.0 / (ny - 50);
+    double amp = sqrt(sc * sc + cc * cc), res = 0;
+    for (unsigned int i = 50; i < ny; i++) {
+        double d = ys[i] - sc * sin(2 * M_PI * 5 * i / 50.0) - cc * cos(2 * M_PI * 5 * i / 50.0);
+        res += d * d;
+    }
+    res = sqrt(res / (ny - 50));
+    printf("Decimators: %u samples at 50 Hz, 5 Hz amplitude %.1f, residual rms %.1f\n", ny, amp,
+           res);
+    if (ny != 200 || fabs(amp - 8000.0) > 160.0 || res > 80.0) {
+        printf("Decimator test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+int spectrumTests() {
+    int errs = 0;
+    // compare the incremental FFT with a direct DFT
+    ustd::realFFT<64, double> fft;
+    double x[64];
+    for (int i = 0; i < 64; i++) {
+        x[i] = fft.data()[i] = testSignal(i * 7) - 20.0;
+    }
+    fft.start(false);
+    int steps = 1;
+    while (!fft.step(5)) {
+        ++steps;
+    }
+    double maxErr = 0;
+    for (int k = 0; k <= 32; k++) {
+        double re = 0, im = 0;
+        for (int n = 0; n < 64; n++) {
+            re += x[n] * cos(2 * M_PI * k * n / 64);
+            im -= x[n] * sin(2 * M_PI * k * n / 64);
+        }
+        double err = fabs(fft.power(k) - (re * re + im * im));
+        maxErr = err > maxErr ? err : maxErr;
+    }
+    printf("realFFT: %d steps, max power error %g\n", steps, maxErr);
+    if (maxErr > 1e-9 || steps < 20) {
+        printf("realFFT test failed!\n");
+        ++errs;
+    }
+
+    // analyzer: 3.0 @ 125 Hz and 1.0 @ 300 Hz at 1 kHz sample rate
+    ustd::Scheduler ssched(4, 16, 4);
+    ustd::SpectrumAnalyzer<256> analyzer("motor", 1000.0, 16);
+    analyzer.addBand(100, 150);
+    analyzer.addBand(280, 320);
+    analyzer.addBand(400, 500);
+    analyzer.addBin(125);
+    analyzer.begin(&ssched, 1);
+    String result;
+    ssched.subscribe(SCHEDULER_MAIN, "motor/spectrum",
+                     [&](String topic, String msg, String orig) { result = msg; });
+    int passes = 0;
+    for (int i = 0; i < 256; i++) {
+        analyzer.addSample(3.0f * sinf(2 * M_PI * 125 * i / 1000.0f) +
+                           1.0f * sinf(2 * M_PI * 300 * i / 1000.0f + 1.0f));
+    }
+    while (analyzer.frames == 0 && passes < 1000) {
+        ssched.loop();
+        ++passes;
+    }
+    ssched.loop();
+    printf("SpectrumAnalyzer: %d passes, %s\n", passes, result.c_str());
+    if (passes < 10 || fabs(analyzer.band(0) - 3.0 / sqrt(2.0)) > 0.05 ||
+        fabs(analyzer.band(1) - 1.0 / sqrt(2.0)) > 0.05 || analyzer.band(2) > 0.05 ||
+        fabs(analyzer.bin(0) - 3.0) > 0.01 || result.find("{\"bands\":[2.1") != 0 ||
+        result.find("],\"bins\":[") == String::npos) {
+        printf("SpectrumAnalyzer test failed!\n");
+        ++errs;
+    }
+    return errs;
+}
+
+struct memStream {
+    uint8_t data[1024];
+    size_t size = 0;
+    size_t pos = 0;
+    size_t write(const uint8_t *buf, size_t len) {
+        if (size + len > sizeof(data)) {
+            len = sizeof(data) - size;
+        }
+        memcpy(data + size, buf, len);
+        size += len;
+        return len;
+    }
+    size_t read(uint8_t *buf, size_t len) {
+        if (pos + len > size) {
+            len = size - pos;
+        }
+        memcpy(buf, data + pos, len);
+        pos += len;
+        return len;
+    }
+};
+
+typedef ustd::msgpackDecoder<memStream, 16> T_MPDECODER;
+
+bool msgpackSkip(T_MPDECODER &dec) {
+    String s;
+    switch (dec.read()) {
+    case T_MPDECODER::INVALID:
+        return false;
+    case T_MPDECODER::STRING:
+        return dec.readString(s);
+    case T_MPDECODER::ARRAY:
+        for (unsigned long i = dec.length(); i; i--) {
+            if (!msgpackSkip(dec)) {
+                return false;
+            }
+        }
+        return true;
+    case T_MPDECODER::MAP:
+        for (unsigned long i = 2 * dec.length(); i; i--) {
+            if (!msgpackSkip(dec)) {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+int msgpackTests() {
+    int errs = 0;
+    // each boundary of the fixint, 8, 16, 32 and 64 bit representations
+    const long long ints[] = {0, 127, 128, 255, 256, 65535, 65536, -1, -32, -33, -128, -129,
+                              -32768, -32769, 4294967295LL, 4294967296LL, -2147483648LL,
+                              -2147483649LL};
+    const size_t intBytes[] = {1, 1, 2, 2, 3, 3, 5, 1, 1, 2, 2, 3, 3, 5, 5, 9, 5, 9};
+    const unsigned int nInts = sizeof(ints) / sizeof(ints[0]);
+    String strs[4];
+    for (unsigned int i = 0; i < 300; i++) {
+        if (i < 31) {
+            strs[1] += (char)('a' + i % 26);
+        }
+        if (i < 32) {
+            strs[2] += (char)('A' + i % 26);
+        }
+        strs[3] += (char)('0' + i % 10);
+    }
+    const size_t strBytes[] = {1, 32, 34, 303};
+
+    // encoding sizes: smallest representation
+    memStream ms;
+    ustd::msgpackEncoder<memStream, 16> enc(ms);
+    for (unsigned int i = 0; i < nInts; i++) {
+        size_t before = ms.size;
+        enc.writeInt(ints[i]);
+        enc.flush();
+        if (ms.size - before != intBytes[i]) {
+            printf("MessagePack: %lld encoded in %u bytes\n", ints[i],
+                   (unsigned)(ms.size - before));
+            ++errs;
+        }
+    }
+    for (unsigned int i = 0; i < 4; i++) {
+        size_t before = ms.size;
+        enc.writeString(strs[i].c_str());
+        enc.flush();
+        if (ms.size - before != strBytes[i]) {
+            printf("MessagePack: string of %u encoded in %u bytes\n", (unsigned)strs[i].length(),
+                   (unsigned)(ms.size - before));
+            ++errs;
+        }
+    }
+
+    // round trip of a document
+    ms.size = 0;
+    enc.writeMap(4);
+    enc.writeString("ints");
+    enc.writeArray(nInts);
+    for (unsigned int i = 0; i < nInts; i++) {
+        enc.writeInt(ints[i]);
+    }
+    enc.writeString("floats");
+    enc.writeArray(2);
+    enc.writeDouble(0.5);
+    enc.writeDouble(0.1);
+    enc.writeString("strings");
+    enc.writeArray(4);
+    for (unsigned int i = 0; i < 4; i++) {
+        enc.writeString(strs[i].c_str());
+    }
+    enc.writeString("other");
+    enc.writeArray(3);
+    enc.writeBool(true);
+    enc.writeBool(false);
+    enc.writeNil();
+    if (!enc.flush()) {
+        printf("MessagePack: encoding failed\n");
+        ++errs;
+    }
+    size_t docSize = ms.size;
+    T_MPDECODER dec(ms);
+    String key;
+    bool ok = dec.read() == T_MPDECODER::MAP && dec.length() == 4;
+    ok = ok && dec.read() == T_MPDECODER::STRING && dec.readString(key) && key == "ints";
+    ok = ok && dec.read() == T_MPDECODER::ARRAY && dec.length() == nInts;
+    for (unsigned int i = 0; ok && i < nInts; i++) {
+        ok = dec.read() == T_MPDECODER::INTEGER && dec.integer() == ints[i];
+    }
+    ok = ok && dec.read() == T_MPDECODER::STRING && dec.readString(key) && key == "floats";
+    ok = ok && dec.read() == T_MPDECODER::ARRAY && dec.length() == 2;
+    ok = ok && dec.read() == T_MPDECODER::FLOAT && dec.number() == 0.5;
+    ok = ok && dec.read() == T_MPDECODER::FLOAT && dec.number() == 0.1;
+    ok = ok && dec.read() == T_MPDECODER::STRING && dec.readString(key) && key == "strings";
+    ok = ok && dec.read() == T_MPDECODER::ARRAY && dec.length() == 4;
+    for (unsigned int i = 0; ok && i < 4; i++) {
+        String s;
+        ok = dec.read() == T_MPDECODER::STRING && dec.readString(s) && s == strs[i];
+    }
+    ok = ok && dec.read() == T_MPDECODER::STRING && dec.readString(key) && key == "other";
+    ok = ok && dec.read() == T_MPDECODER::ARRAY && dec.length() == 3;
+    ok = ok && dec.read() == T_MPDECODER::BOOLEAN && dec.boolean();
+    ok = ok && dec.read() == T_MPDECODER::BOOLEAN && !dec.boolean();
+    ok = ok && dec.read() == T_MPDECODER::NIL && dec.ok();
+    ok = ok && dec.read() == T_MPDECODER::INVALID;
+    if (!ok) {
+        printf("MessagePack: round trip failed\n");
+        ++errs;
+    }
+
+    // malformed input: every truncation must be detected
+    for (size_t cut = 0; cut < docSize; cut++) {
+        ms.size = cut;
+        ms.pos = 0;
+        T_MPDECODER tdec(ms);
+        if (msgpackSkip(tdec)) {
+            printf("MessagePack: truncation at %u not detected\n", (unsigned)cut);
+            ++errs;
+            break;
+        }
+    }
+    // unsupported bin8 type and a corrupted string length
+    const uint8_t bad[] = {0xc4, 0x01, 0x00, 0xdb, 0xff, 0xff, 0xff, 0xff, 0x41};
+    ms.size = 0;
+    ms.pos = 0;
+    ms.write(bad, sizeof(bad));
+    T_MPDECODER bdec(ms);
+    if (bdec.read() != T_MPDECODER::INVALID || bdec.ok()) {
+        printf("MessagePack: unsupported type not rejected\n");
+        ++errs;
+    }
+    ms.pos = 3;
+    T_MPDECODER sdec(ms);
+    if (sdec.read() != T_MPDECODER::STRING || sdec.readString(key)) {
+        printf("MessagePack: corrupted string length not rejected\n");
+        ++errs;
+    }
+    printf("MessagePack: document of %u bytes\n", (unsigned)docSize);
+    return errs;
+}
+
+bool writeTestFile(const char *filename, const String &content) {
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(content.c_str(), 1, content.length(), f) == content.length();
+    fclose(f);
+    return ok;
+}
+
+int jsonMappedFileTests() {
+    int errs = 0;
+    const char *fn = "/tmp/muwerk-test-map.json";
+    String doc = "{\"net\": {\"hostname\": \"gw1\", \"port\": 8080, \"dhcp\": true, "
+                 "\"dns\": null},\n"
+                 " \"esc\": \"a\\\"b\\\\c\\/d\\n\\u00e4\\ud83d\\ude00\\ud800x\",\n"
+                 " \"devices\": [{\"name\": \"d0\", \"port\": 500}, {\"name\": \"d1\", "
+                 "\"port\": 501.5}],\n"
+                 " \"empty\": {}, \"arr\": [], \"a\": {\"\": {\"b\": 7}}}\n";
+    ustd::jsonmappedfile jmf;
+    if (!writeTestFile(fn, doc) || !jmf.open(fn)) {
+        printf("jsonmappedfile: cannot open test file\n");
+        return 1;
+    }
+    ustd::jsonview devices = jmf.find("devices");
+    unsigned int nDevices = devices.size();
+    bool ok = jmf.readString("net/hostname", "") == "gw1" && jmf.readLong("net/port", 0) == 8080 &&
+              jmf.readBool("net/dhcp", false) && jmf.find("net/dns").typeOf() == "null" &&
+              jmf.readDouble("devices/1/port", 0.0) == 501.5 && devices.size() == 2 &&
+              devices[1]["name"] == "d1" && devices[0]["port"].toLong() == 500 &&
+              jmf.find("empty").size() == 0 && jmf.find("arr").type() == ustd::jsonview::ARRAY &&
+              jmf.readLong("a//b", 0) == 7 && !jmf.exists("a/b");
+    if (!ok) {
+        printf("jsonmappedfile: lookup failed\n");
+        ++errs;
+    }
+    // missing keys, wrong types and out of range indices
+    if (jmf.exists("net/gateway") || jmf.exists("devices/2") || jmf.exists("net/port/x") ||
+        jmf.readLong("net/hostname", -1) != -1 || jmf.readString("net/port", "-") != "-" ||
+        jmf.readBool("nothing/here", true) != true) {
+        printf("jsonmappedfile: missing keys not handled\n");
+        ++errs;
+    }
+    // escapes, including a surrogate pair and an unpaired surrogate
+    if (jmf.readString("esc", "") != "a\"b\\c/d\n\xc3\xa4\xf0\x9f\x98\x80\xef\xbf\xbdx" ||
+        !(jmf.find("esc") == "a\"b\\c/d\n\xc3\xa4\xf0\x9f\x98\x80\xef\xbf\xbdx")) {
+        printf("jsonmappedfile: unescaping failed: %s\n", jmf.readString("esc", "").c_str());
+        ++errs;
+    }
+    // malformed documents are rejected, reopening invalidates all views
+    String deep = "";
+    for (int i = 0; i < JSONFILE_MAP_DEPTH + 1; i++) {
+        deep = "[" + deep + "]";
+    }
+    const char *bad[] = {"",      "{",    "{\"a\": 1",     "{\"a\" 1}", "[1, 2,]", "[1 2]",
+                         "\"abc", "tru",  "{\"a\": 1} x", "{1: 2}",   "[\"a\\\"]"};
+    for (unsigned int i = 0; i <= sizeof(bad) / sizeof(bad[0]); i++) {
+        String content = i < sizeof(bad) / sizeof(bad[0]) ? String(bad[i]) : deep;
+        if (!writeTestFile(fn, content) || jmf.open(fn) || jmf.isOpen()) {
+            printf("jsonmappedfile: malformed document %u not rejected\n", i);
+            ++errs;
+        }
+    }
+    remove(fn);
+    printf("jsonmappedfile: %u devices\n", nDevices);
+    return errs;
+}
+
+int jsonBatchTests() {
+    int errs = 0;
+    const char *fn = "/tmp/muwerk-test-batch.json";
+    String doc = "{\"net\": {\"hostname\": \"gw\", \"services\": {\"http\": 8080, "
+                 "\"mqtt\": 1883}, \"dhcp\": false, \"\": {\"x\": 4}},\n"
+                 " \"ratio\": 0.25, \"tls\": true, \"ports\": [21, 22, 23]}\n";
+    ustd::jsonmappedfile jmf;
+    if (!writeTestFile(fn, doc) || !jmf.open(fn)) {
+        printf("jsonbatch: cannot open test file\n");
+        return 1;
+    }
+    String host, name, wrong;
+    long http = 0, mqtt = 0, ssh = 0, missing = 0;
+    double ratio = 0.0;
+    bool tls = false, dhcp = true, nb = false;
+    ustd::jsonbatch batch;
+    // unsorted, with shared prefixes, array indices, missing keys and wrong types
+    batch.add("tls", &tls);
+    batch.add("net/services/mqtt", &mqtt);
+    batch.add("net/hostname", &host, "dflt");
+    batch.add("ports/1", &ssh);
+    batch.add("net/services/http", &http);
+    batch.add("ratio", &ratio);
+    batch.add("net/dhcp", &dhcp, true);
+    batch.add("net/name", &name, "dflt");
+    batch.add("net/services/none/port", &missing, 7L);
+    batch.add("net/services/http/port", &wrong, "short");
+    batch.add("ratio", &nb, true);
+    unsigned int found = jmf.readBatch(batch);
+    // empty segments are resolved like in jsonmappedfile::find()
+    long empty = 0;
+    ustd::jsonbatch emptyBatch;
+    emptyBatch.add("net//x", &empty, 3L);
+    if (jmf.readBatch(emptyBatch) != 1 || empty != 4 || jmf.readLong("net//x", 0) != 4) {
+        printf("jsonbatch: empty segments not resolved\n");
+        ++errs;
+    }
+    if (found != 7 || host != "gw" || http != 8080 || mqtt != 1883 || ssh != 22 || !tls ||
+        dhcp || ratio != 0.25 || name != "dflt" || missing != 7 || wrong != "short" || !nb) {
+        printf("jsonbatch: found %u of %u: host=%s http=%ld mqtt=%ld ssh=%ld ratio=%f\n", found,
+               batch.length(), host.c_str(), http, mqtt, ssh, ratio);
+        ++errs;
+    }
+    if (batch.length() != 11) {
+        printf("jsonbatch: %u keys\n", batch.length());
+        ++errs;
+    }
+    batch.clear();
+    if (batch.length() != 0 || jmf.readBatch(batch) != 0) {
+        printf("jsonbatch: clear failed\n");
+        ++errs;
+    }
+    remove(fn);
+    printf("jsonbatch: found %u values\n", found);
+    return errs;
+}
+
 int main() {
     cout << "Testing mustd..." << endl;
     array<int> ar = array<int>(1, 100, 1);
@@ -206,8 +1549,28 @@ int main() {
     cout << "Done sched test" << endl;
 
     numericTests();
+    int nerrs = numericGridTests();
+    nerrs += numericSplineTests();
+    nerrs += numericBatchTests();
+    nerrs += constNumericTests();
+    nerrs += numericViewTests();
+    nerrs += sensorTests();
+    nerrs += sensorbankTests();
+    nerrs += filterEngineTests();
+    nerrs += sensorPipelineTests();
+    nerrs += sensorHistoryTests();
+    nerrs += timeSeriesTests();
+    nerrs += timeSeriesStoreTests();
+    nerrs += adaptiveRateTests();
+    nerrs += outlierTests();
+    nerrs += thresholdTests();
+    nerrs += decimatorTests();
+    nerrs += spectrumTests();
+    nerrs += msgpackTests();
+    nerrs += jsonMappedFileTests();
+    nerrs += jsonBatchTests();
 
-    int nerrs = testcases();
+    nerrs += testcases();
     if (nerrs > 0)
         return -1;
     else
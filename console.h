@@ -46,7 +46,7 @@ there are additional builtin commands available:
 * ls: display directory contents
 * cat: outputs the specified files
 * rm: removes the specified files
-* jf: read, write or delete values in json files
+* jf: read, write or delete values in json files, export files as json
 
 The commandline parser can be extended (see example below)
 
@@ -324,6 +324,9 @@ class Console {
 #ifdef __ESP__
     void cmd_reboot() {
         printer->println("Restarting...");
+#ifdef USTD_FEATURE_FILESYSTEM
+        jsonfile::flushAll();
+#endif
         ESP.restart();
     }
 
@@ -696,6 +699,8 @@ class Console {
             cmd_jf_set();
         } else if (arg == "del") {
             cmd_jf_del();
+        } else if (arg == "export") {
+            cmd_jf_export();
         } else {
             printer->println("error: bad command " + arg + "specified.");
             cmd_jf_help();
@@ -706,6 +711,7 @@ class Console {
         printer->println("usage: jf get <jsonpath>");
         printer->println("usage: jf set <jsonpath> <jsonvalue>");
         printer->println("usage: jf del <jsonpath>");
+        printer->println("usage: jf export <filename>");
     }
 
     void cmd_jf_get() {
@@ -772,6 +778,28 @@ class Console {
 #endif
         }
     }
+
+    void cmd_jf_export() {
+        String arg = pullArg();
+
+        if (arg == "-h" || arg == "-H" || arg == "") {
+            cmd_jf_help();
+            return;
+        }
+        if (arg.startsWith("/")) {
+            arg = arg.substring(1);
+        }
+
+        ustd::jsonfile jf;
+        String json;
+        if (!jf.exportJson(arg, json)) {
+#ifndef USE_SERIAL_DBG
+            printer->println("error: Cannot read file " + arg);
+#endif
+            return;
+        }
+        printer->println(json);
+    }
 #endif
 
     bool cmd_custom(String &cmd) {
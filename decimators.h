@@ -0,0 +1,306 @@
+// decimators.h - muwerk fixed-point decimation filters
+
+#pragma once
+
+#include "ustd_platform.h"
+
+#include <stdint.h>
+#include <math.h>
+
+namespace ustd {
+
+/*!  \brief muwerk cicDecimator class
+
+cicDecimator implements a fixed-point cascaded integrator-comb (CIC) decimator for
+    * high-rate acquisition (e.g. vibration or current sampled at several kHz) that
+    * needs to be reduced to a low, band-limited rate before publishing.
+    *
+    * A CIC filter needs no multiplications: N integrators run at the input rate,
+    * N combs run at the output rate (1/R of the input rate). The integrators wrap
+    * around on overflow, which is harmless as long as T_ACC has at least
+    * `input bits + N * ceil(log2(R))` bits. With the default uint32_t accumulator
+    * and 16 bit samples, `N * ceil(log2(R))` must not exceed 16 (e.g. R=32 with
+    * N=3), for larger decimation ratios use uint64_t.
+    *
+    * The output is normalized by the DC gain R^N, so a constant input produces the
+    * same constant output. The pass band of a CIC filter droops, use a \ref
+    * firDecimator as a second stage for a flat response and steep cutoff.
+    *
+    * Example:
+
+~~~{.cpp}
+ustd::cicDecimator<16, 3> cic;  // 4 kHz -> 250 Hz
+
+void adcBlockReady(const int16_t *samples, unsigned int count) {
+    int32_t out[8];
+    unsigned int n = cic.process(samples, count, out);
+    // out[0..n-1] contains the decimated samples
+}
+~~~
+*/
+template <unsigned int R, unsigned int N = 3, typename T_SAMPLE = int16_t,
+          typename T_ACC = uint32_t>
+class cicDecimator {
+  private:
+    T_ACC integ[N];
+    T_ACC comb[N];
+    unsigned int phase;
+
+    static constexpr uint64_t ipow(uint64_t b, unsigned int e) {
+        return e ? b * ipow(b, e - 1) : 1;
+    }
+    static constexpr unsigned int ilog2(uint64_t v) {
+        return v > 1 ? 1 + ilog2(v >> 1) : 0;
+    }
+
+  public:
+    static const uint64_t gain = ipow(R, N);  //!< DC gain of the filter
+    //! Normalization shift, if the gain is a power of two
+    static const unsigned int gainShift = (gain & (gain - 1)) ? 0 : ilog2(gain);
+
+    cicDecimator() {
+        /*! Creates a new CIC decimator with decimation ratio R and N stages */
+        reset();
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        for (unsigned int i = 0; i < N; i++) {
+            integ[i] = 0;
+            comb[i] = 0;
+        }
+        phase = 0;
+    }
+
+    unsigned int process(const T_SAMPLE *pIn, unsigned int count, int32_t *pOut) {
+        /*! Decimate a block of samples
+        @param pIn Input samples
+        @param count Number of input samples
+        @param pOut Buffer for the output samples, must hold at least count / R + 1 samples
+        @return Number of output samples written to pOut
+        */
+        unsigned int outCount = 0;
+        while (count) {
+            // run the integrators up to the next output sample
+            unsigned int run = R - phase;
+            if (run > count) {
+                run = count;
+            }
+            integrate(pIn, run);
+            pIn += run;
+            count -= run;
+            phase += run;
+            if (phase == R) {
+                phase = 0;
+                pOut[outCount++] = decimate();
+            }
+        }
+        return outCount;
+    }
+
+    bool filter(T_SAMPLE sample, int32_t *pOut) {
+        /*! Process a single sample
+        @param sample Input sample
+        @param pOut Receives the output sample, if available
+        @return true, if a new output sample is available (every R-th input sample)
+        */
+        return process(&sample, 1, pOut) == 1;
+    }
+
+  private:
+    void integrate(const T_SAMPLE *pIn, unsigned int count) {
+        // local copies keep the integrator chain in registers
+        T_ACC acc[N];
+        for (unsigned int i = 0; i < N; i++) {
+            acc[i] = integ[i];
+        }
+        for (unsigned int k = 0; k < count; k++) {
+            acc[0] += (T_ACC)(int32_t)pIn[k];
+            for (unsigned int i = 1; i < N; i++) {
+                acc[i] += acc[i - 1];
+            }
+        }
+        for (unsigned int i = 0; i < N; i++) {
+            integ[i] = acc[i];
+        }
+    }
+
+    int32_t decimate() {
+        T_ACC v = integ[N - 1];
+        for (unsigned int i = 0; i < N; i++) {
+            T_ACC t = v;
+            v -= comb[i];
+            comb[i] = t;
+        }
+        // reinterpret the wrapped accumulator as two's complement value
+        int64_t s = sizeof(T_ACC) < sizeof(int64_t) ? (int64_t)(int32_t)(uint32_t)v : (int64_t)v;
+        if (gainShift) {
+            return (int32_t)(s >> gainShift);
+        }
+        return (int32_t)(s / (int64_t)gain);
+    }
+};
+
+/*!  \brief muwerk firDecimator class
+
+firDecimator implements a fixed-point polyphase FIR decimator: a low pass FIR
+    * filter with TAPS Q15 coefficients, of which only every R-th output sample is
+    * computed. This costs TAPS/R multiply-accumulates per input sample.
+    *
+    * The delay line is stored twice in a row, so that the dot product runs over
+    * contiguous memory. On Linux, this loop is vectorized by the compiler, on
+    * MCUs it compiles to a tight 16x16->32 bit multiply-accumulate loop.
+    *
+    * The coefficients can be supplied by the application or designed with
+    * \ref designLowpass. The accumulator type T_ACC must hold the sum of all
+    * products, int32_t is sufficient for samples in the 16 bit range (including
+    * the normalized output of a \ref cicDecimator with 16 bit input) and
+    * coefficients with a sum of absolute values up to 2.0.
+    *
+    * Example:
+
+~~~{.cpp}
+ustd::cicDecimator<16, 3> cic;            // 4 kHz -> 250 Hz
+ustd::firDecimator<32, 5, int32_t> fir;   // 250 Hz -> 50 Hz
+
+void setup() {
+    fir.designLowpass(20.0 / 250.0);      // 20 Hz cutoff
+}
+
+void adcBlockReady(const int16_t *samples, unsigned int count) {
+    int32_t mid[8], out[2];
+    unsigned int n = cic.process(samples, count, mid);
+    n = fir.process(mid, n, out);
+    // out[0..n-1] contains the band-limited 50 Hz stream
+}
+~~~
+*/
+template <unsigned int TAPS, unsigned int R, typename T_SAMPLE = int16_t,
+          typename T_ACC = int32_t>
+class firDecimator {
+  public:
+    //! Q15 filter coefficients, coeffs[0] is applied to the newest sample
+    int16_t coeffs[TAPS];
+
+  private:
+    T_SAMPLE delay[2 * TAPS];
+    unsigned int pos;
+    unsigned int phase;
+
+  public:
+    firDecimator() {
+        /*! Creates a new FIR decimator with TAPS taps and decimation ratio R
+         *
+         * The filter is initialized with a low pass at 0.4 / R of the input sample
+         * rate.
+         */
+        designLowpass(0.4 / R);
+    }
+
+    firDecimator(const int16_t *pCoeffs) {
+        /*! Creates a new FIR decimator with given coefficients
+        @param pCoeffs TAPS Q15 filter coefficients
+        */
+        setCoefficients(pCoeffs);
+    }
+
+    void setCoefficients(const int16_t *pCoeffs) {
+        /*! Set the filter coefficients and reset the filter
+        @param pCoeffs TAPS Q15 filter coefficients
+        */
+        for (unsigned int i = 0; i < TAPS; i++) {
+            coeffs[i] = pCoeffs[i];
+        }
+        reset();
+    }
+
+    void designLowpass(double cutoff) {
+        /*! Design a windowed-sinc (Hamming) low pass filter with unity DC gain
+        @param cutoff Cutoff frequency relative to the input sample rate (0 .. 0.5). To avoid
+        aliasing, this should be below 0.5 / R.
+        */
+        double h[TAPS];
+        double sum = 0.0;
+        for (unsigned int i = 0; i < TAPS; i++) {
+            double m = (double)i - (TAPS - 1) / 2.0;
+            double x = 2.0 * M_PI * cutoff * m;
+            h[i] = m == 0.0 ? 2.0 * cutoff : sin(x) / (M_PI * m);
+            if (TAPS > 1) {
+                h[i] *= 0.54 - 0.46 * cos(2.0 * M_PI * i / (TAPS - 1));
+            }
+            sum += h[i];
+        }
+        // quantize with error feedback, so that the coefficients sum up to exactly 1.0
+        double err = 0.0;
+        for (unsigned int i = 0; i < TAPS; i++) {
+            double v = h[i] / sum * 32768.0 + err;
+            double q = floor(v + 0.5);
+            if (q > 32767.0) {
+                q = 32767.0;
+            }
+            err = v - q;
+            coeffs[i] = (int16_t)q;
+        }
+        reset();
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        for (unsigned int i = 0; i < 2 * TAPS; i++) {
+            delay[i] = 0;
+        }
+        pos = 0;
+        phase = 0;
+    }
+
+    unsigned int process(const T_SAMPLE *pIn, unsigned int count, T_SAMPLE *pOut) {
+        /*! Decimate a block of samples
+        @param pIn Input samples
+        @param count Number of input samples
+        @param pOut Buffer for the output samples, must hold at least count / R + 1 samples
+        @return Number of output samples written to pOut
+        */
+        unsigned int outCount = 0;
+        for (unsigned int k = 0; k < count; k++) {
+            // newest sample at the lowest index: the window is delay[pos .. pos + TAPS - 1]
+            pos = pos ? pos - 1 : TAPS - 1;
+            delay[pos] = pIn[k];
+            delay[pos + TAPS] = pIn[k];
+            if (++phase == R) {
+                phase = 0;
+                pOut[outCount++] = dot(delay + pos);
+            }
+        }
+        return outCount;
+    }
+
+    bool filter(T_SAMPLE sample, T_SAMPLE *pOut) {
+        /*! Process a single sample
+        @param sample Input sample
+        @param pOut Receives the output sample, if available
+        @return true, if a new output sample is available (every R-th input sample)
+        */
+        return process(&sample, 1, pOut) == 1;
+    }
+
+  private:
+    T_SAMPLE dot(const T_SAMPLE *__restrict pWindow) const {
+        const int16_t *__restrict pCoeffs = coeffs;
+        T_ACC acc = 0;
+        for (unsigned int i = 0; i < TAPS; i++) {
+            acc += (T_ACC)pCoeffs[i] * (T_ACC)pWindow[i];
+        }
+        // round and scale back from Q15
+        acc = (acc + (1 << 14)) >> 15;
+        if (sizeof(T_SAMPLE) == sizeof(int16_t)) {
+            if (acc > 32767) {
+                acc = 32767;
+            } else if (acc < -32768) {
+                acc = -32768;
+            }
+        }
+        return (T_SAMPLE)acc;
+    }
+};
+
+}  // namespace ustd
@@ -5,6 +5,9 @@
 
 #include "scheduler.h"
 #include "heartbeat.h"
+#ifdef USTD_FEATURE_FILESYSTEM
+#include "jsonfile.h"
+#endif
 
 namespace ustd {
 
@@ -188,6 +191,9 @@ class Doctor {
         }
 #ifdef __ESP__
         if (topic == name + "/restart") {
+#ifdef USTD_FEATURE_FILESYSTEM
+            jsonfile::flushAll();
+#endif
             ESP.restart();
         }
 #endif
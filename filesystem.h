@@ -110,6 +110,46 @@ bool fsDelete(String filename) {
     return ret;
 }
 
+bool fsExists(String filename) {
+    /*! This function checks if the specified file exists.
+    @param filename Absolute filename of the file to check
+    @return true if the file exists
+    */
+#ifdef __USE_SPIFFS_FS__
+    return fsBegin() && SPIFFS.exists(filename);
+#else
+    return fsBegin() && LittleFS.exists(filename);
+#endif
+}
+
+bool fsRename(String from, String to) {
+    /*! This function renames a file. An existing file with the new name is replaced.
+    @param from Absolute filename of the file to be renamed
+    @param to New absolute filename
+    @return true on success
+    */
+    if (!fsBegin()) {
+        return false;
+    }
+#ifdef __USE_SPIFFS_FS__
+    bool ret = SPIFFS.rename(from, to);
+    if (!ret && SPIFFS.exists(to)) {
+        // not all file systems replace existing files on rename
+        ret = SPIFFS.remove(to) && SPIFFS.rename(from, to);
+    }
+#else
+    bool ret = LittleFS.rename(from, to);
+    if (!ret && LittleFS.exists(to)) {
+        // not all file systems replace existing files on rename
+        ret = LittleFS.remove(to) && LittleFS.rename(from, to);
+    }
+#endif
+    if (!ret) {
+        DBG("Failed to rename file " + from + " to " + to);
+    }
+    return ret;
+}
+
 fs::File fsOpen(String filename, String mode) {
     /*! This function opens the specified file and returns a file object.
     @param filename Absolute filename of the file to be opened
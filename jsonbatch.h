@@ -0,0 +1,217 @@
+// jsonbatch.h - muwerk batches of json keys
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "ustd_array.h"
+#include "jsonpath.h"
+
+#include <string.h>
+
+namespace ustd {
+
+class jsonfile;
+class jsonmappedfile;
+
+/*! \brief muwerk JSON Batch Class
+
+A jsonbatch is a list of keys with target variables and default values that
+are read by \ref jsonfile::readBatch (or \ref jsonmappedfile::readBatch) in a
+single traversal of the documents.
+The keys are kept sorted, so that keys with a common prefix are resolved
+together: each object on the way is looked up once, independent of the
+number of keys below it.
+
+~~~{.cpp}
+    String hostname;
+    long port;
+    bool dhcp;
+
+    ustd::jsonbatch cfg;
+    cfg.add("net/hostname", &hostname, "muwerk");
+    cfg.add("net/services/http/port", &port, 80L);
+    cfg.add("net/station/dhcp", &dhcp, true);
+
+    ustd::jsonfile jf;
+    jf.readBatch(cfg);
+~~~
+
+Target variables that are not found or have the wrong type in the file
+receive their default value.
+*/
+class jsonbatch {
+  private:
+    friend class jsonfile;
+    friend class jsonmappedfile;
+
+    enum Type { STRING, LONG, DOUBLE, BOOL };
+
+    typedef struct {
+        jsonpath key;
+        Type type;
+        void *pValue;
+        String defString;
+        double defNumber;
+    } T_ENTRY;
+
+    ustd::array<T_ENTRY *> entries;
+
+  public:
+    jsonbatch() {
+        /*! Creates an empty batch */
+    }
+
+    jsonbatch(const jsonbatch &) = delete;
+    jsonbatch &operator=(const jsonbatch &) = delete;
+
+    ~jsonbatch() {
+        clear();
+    }
+
+    void add(const jsonpath &key, String *pValue, String defaultVal = "") {
+        /*! Add a string value to the batch
+        @param key Combined filename and json-object-path.
+        @param pValue Pointer to the variable that receives the value.
+        @param defaultVal value assigned, if key is not found.
+        */
+        insert(key, STRING, pValue, defaultVal, 0.0);
+    }
+
+    void add(const jsonpath &key, long *pValue, long defaultVal = 0) {
+        /*! Add a long integer value to the batch
+        @param key Combined filename and json-object-path.
+        @param pValue Pointer to the variable that receives the value.
+        @param defaultVal value assigned, if key is not found.
+        */
+        insert(key, LONG, pValue, "", (double)defaultVal);
+    }
+
+    void add(const jsonpath &key, double *pValue, double defaultVal = 0.0) {
+        /*! Add a double value to the batch
+        @param key Combined filename and json-object-path.
+        @param pValue Pointer to the variable that receives the value.
+        @param defaultVal value assigned, if key is not found.
+        */
+        insert(key, DOUBLE, pValue, "", defaultVal);
+    }
+
+    void add(const jsonpath &key, bool *pValue, bool defaultVal = false) {
+        /*! Add a boolean value to the batch
+        @param key Combined filename and json-object-path.
+        @param pValue Pointer to the variable that receives the value.
+        @param defaultVal value assigned, if key is not found.
+        */
+        insert(key, BOOL, pValue, "", defaultVal ? 1.0 : 0.0);
+    }
+
+    unsigned int length() {
+        /*! Number of keys in the batch
+        @return Number of keys
+        */
+        return entries.length();
+    }
+
+    void clear() {
+        /*! Remove all keys from the batch */
+        for (unsigned int i = 0; i < entries.length(); i++) {
+            delete entries[i];
+        }
+        entries.erase();
+    }
+
+  private:
+    static int compare(const jsonpath &a, const jsonpath &b) {
+        // segment by segment, a key sorts before all keys below it
+        for (unsigned int i = 0; i < a.length() && i < b.length(); i++) {
+            int res = strcmp(a[i], b[i]);
+            if (res) {
+                return res;
+            }
+        }
+        return (int)a.length() - (int)b.length();
+    }
+
+    void insert(const jsonpath &key, Type type, void *pValue, String defString,
+                double defNumber) {
+        T_ENTRY *pEntry = new T_ENTRY();
+        pEntry->key = key;
+        pEntry->type = type;
+        pEntry->pValue = pValue;
+        pEntry->defString = defString;
+        pEntry->defNumber = defNumber;
+        if (entries.add(pEntry) == -1) {
+            DBG("jsonbatch: cannot add key " + key.toString());
+            delete pEntry;
+            return;
+        }
+        for (unsigned int i = entries.length() - 1; i > 0; i--) {
+            if (compare(entries[i - 1]->key, key) <= 0) {
+                break;
+            }
+            entries[i] = entries[i - 1];
+            entries[i - 1] = pEntry;
+        }
+    }
+
+    unsigned int groupEnd(unsigned int first, unsigned int last, unsigned int level) {
+        // end of the range of keys that share the segments up to level
+        const jsonpath &key = entries[first]->key;
+        unsigned int end = first + 1;
+        while (end < last && entries[end]->key.length() > level &&
+               entries[end]->key.hash(level) == key.hash(level) &&
+               !strcmp(entries[end]->key[level], key[level])) {
+            ++end;
+        }
+        return end;
+    }
+
+    bool assign(unsigned int index, const String &type, const char *str, double number) {
+        // type in the notation of JSON.typeof(), str is the value of a string, number the
+        // value of a number or boolean
+        T_ENTRY *pEntry = entries[index];
+        static const char *expected[] = {"string", "number", "number", "boolean"};
+        if (type != expected[pEntry->type]) {
+            DBG("From " + pEntry->key.toString() + ", element has wrong type '" + type +
+                "' - expected '" + expected[pEntry->type] + "'");
+            assignDefault(index, index + 1);
+            return false;
+        }
+        switch (pEntry->type) {
+        case STRING:
+            *(String *)pEntry->pValue = str;
+            break;
+        case LONG:
+            *(long *)pEntry->pValue = (long)number;
+            break;
+        case DOUBLE:
+            *(double *)pEntry->pValue = number;
+            break;
+        case BOOL:
+            *(bool *)pEntry->pValue = number != 0.0;
+            break;
+        }
+        return true;
+    }
+
+    void assignDefault(unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++) {
+            T_ENTRY *pEntry = entries[i];
+            switch (pEntry->type) {
+            case STRING:
+                *(String *)pEntry->pValue = pEntry->defString;
+                break;
+            case LONG:
+                *(long *)pEntry->pValue = (long)pEntry->defNumber;
+                break;
+            case DOUBLE:
+                *(double *)pEntry->pValue = pEntry->defNumber;
+                break;
+            case BOOL:
+                *(bool *)pEntry->pValue = pEntry->defNumber != 0.0;
+                break;
+            }
+        }
+    }
+};
+
+}  // namespace ustd
@@ -6,16 +6,452 @@
 #include "ustd_array.h"
 #include "ustd_map.h"
 #include "muwerk.h"
+#include "scheduler.h"
 #include "filesystem.h"
 
 #include <Arduino_JSON.h>  // Platformio lib no. 6249
 
-#ifndef MAX_FRICKEL_DEPTH
-#define MAX_FRICKEL_DEPTH 9
+#include "jsonpath.h"
+#include "jsonbatch.h"
+#include "jsonmap.h"
+#include "msgpack.h"
+
+#include <limits.h>
+
+#ifndef JSONFILE_CACHE_SIZE
+#if (defined(__ESP__) && !defined(__ESP32__) && !defined(__ESP32_RISC__)) || \
+    USTD_FEATURE_MEMORY < USTD_FEATURE_MEM_8K
+// parsed trees need 5-10 times the size of the file, too much for ESP8266 and AVR
+#define JSONFILE_CACHE_SIZE 0
+#else
+#define JSONFILE_CACHE_SIZE 8192
+#endif
+#endif
+
+#ifndef JSONFILE_CACHE_VERIFY
+#define JSONFILE_CACHE_VERIFY 1000
+#endif
+
+#ifndef JSONFILE_STREAM_SIZE
+#if JSONFILE_CACHE_SIZE > 4096
+// files that fit into the cache are parsed once instead of being rescanned for every key
+#define JSONFILE_STREAM_SIZE JSONFILE_CACHE_SIZE
+#else
+#define JSONFILE_STREAM_SIZE 4096
+#endif
+#endif
+
+#ifndef JSONFILE_STREAM_CHUNK
+#define JSONFILE_STREAM_CHUNK 128
+#endif
+
+#ifdef JSONFILE_MSGPACK
+#define JSONFILE_EXT ".msgpack"
+#else
+#define JSONFILE_EXT ".json"
 #endif
 
 namespace ustd {
 
+/*! \brief muwerk JSON Stream Reader Class
+
+Extracts the value of a single key path from a JSON file without building
+the document tree: the file is tokenized in chunks of `JSONFILE_STREAM_CHUNK`
+bytes, all members that are not on the key path are skipped. Only the raw
+JSON text of the requested value is kept in memory, so the peak memory usage
+is bounded by the chunk size and the size of the value, not by the size of
+the file.
+
+~~~{.cpp}
+    fs::File f = ustd::fsOpen("/net.json", "r");
+    ustd::jsonstreamreader reader(f);
+    String raw;
+    if (reader.find(ustd::jsonpath("net/station/hostname"), 1, raw)) {
+        // raw contains the JSON text of the value, e.g. "\"myhost\""
+    }
+    f.close();
+~~~
+*/
+class jsonstreamreader {
+  private:
+    fs::File &f;
+    char buf[JSONFILE_STREAM_CHUNK];
+    unsigned int len = 0;
+    unsigned int pos = 0;
+    String *pCapture = nullptr;
+
+  public:
+    jsonstreamreader(fs::File &f) : f(f) {
+        /*! Creates a stream reader for an opened file
+        @param f File opened for reading, positioned at the start of the JSON document
+        */
+    }
+
+    bool find(const jsonpath &keypath, unsigned int first, String &value) {
+        /*! Find the value of a key path
+        @param keypath Key path of the value
+        @param first Index of the first segment of keypath that is an object member name,
+                     e.g. 1 if the first segment is the filename
+        @param value Receives the JSON text of the value, if found
+        @return `true` if the value was found.
+        */
+        if (first >= keypath.length()) {
+            return false;
+        }
+        return findMember(keypath, first, value);
+    }
+
+  private:
+    int peek() {
+        if (pos == len) {
+            len = f.read((uint8_t *)buf, sizeof(buf));
+            pos = 0;
+            if (!len) {
+                return -1;
+            }
+        }
+        return buf[pos];
+    }
+
+    int next() {
+        int c = peek();
+        if (c != -1) {
+            ++pos;
+            if (pCapture) {
+                *pCapture += (char)c;
+            }
+        }
+        return c;
+    }
+
+    int skipWhitespace() {
+        int c = peek();
+        while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++pos;
+            c = peek();
+        }
+        return c;
+    }
+
+    bool readString(String *pStr, uint32_t *pHash = nullptr) {
+        long high = -1;  // pending high surrogate of a \u escape
+        next();          // opening quote
+        for (int c = next(); c != '"'; c = next()) {
+            if (c == -1) {
+                return false;
+            }
+            long cp = c;
+            if (c == '\\') {
+                c = next();
+                switch (c) {
+                case -1:
+                    return false;
+                case 'b':
+                    cp = '\b';
+                    break;
+                case 'f':
+                    cp = '\f';
+                    break;
+                case 'n':
+                    cp = '\n';
+                    break;
+                case 'r':
+                    cp = '\r';
+                    break;
+                case 't':
+                    cp = '\t';
+                    break;
+                case 'u':
+                    cp = readHex();
+                    if (cp < 0) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+            if (high != -1 && cp >= 0xdc00 && cp <= 0xdfff) {
+                cp = 0x10000 + ((high - 0xd800) << 10) + (cp - 0xdc00);
+            } else if (high != -1) {
+                // unpaired surrogate
+                appendUtf8(pStr, pHash, 0xfffd);
+            }
+            high = -1;
+            if (cp >= 0xd800 && cp < 0xdc00) {
+                high = cp;
+            } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                // unpaired low surrogate
+                appendUtf8(pStr, pHash, 0xfffd);
+            } else {
+                appendUtf8(pStr, pHash, (unsigned long)cp);
+            }
+        }
+        if (high != -1) {
+            appendUtf8(pStr, pHash, 0xfffd);
+        }
+        return true;
+    }
+
+    long readHex() {
+        long v = 0;
+        for (int i = 0; i < 4; i++) {
+            int c = next();
+            if (c >= '0' && c <= '9') {
+                v = v * 16 + c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                v = v * 16 + c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                v = v * 16 + c - 'A' + 10;
+            } else {
+                return -1;
+            }
+        }
+        return v;
+    }
+
+    static void put(String *pStr, uint32_t *pHash, char c) {
+        if (pStr) {
+            *pStr += c;
+        }
+        if (pHash) {
+            // FNV-1a, same as jsonpath::hashOf()
+            *pHash = (*pHash ^ (uint8_t)c) * 16777619UL;
+        }
+    }
+
+    static void appendUtf8(String *pStr, uint32_t *pHash, unsigned long cp) {
+        if (cp < 0x80) {
+            put(pStr, pHash, (char)cp);
+        } else if (cp < 0x800) {
+            put(pStr, pHash, (char)(0xc0 | (cp >> 6)));
+            put(pStr, pHash, (char)(0x80 | (cp & 0x3f)));
+        } else if (cp < 0x10000) {
+            put(pStr, pHash, (char)(0xe0 | (cp >> 12)));
+            put(pStr, pHash, (char)(0x80 | ((cp >> 6) & 0x3f)));
+            put(pStr, pHash, (char)(0x80 | (cp & 0x3f)));
+        } else {
+            put(pStr, pHash, (char)(0xf0 | (cp >> 18)));
+            put(pStr, pHash, (char)(0x80 | ((cp >> 12) & 0x3f)));
+            put(pStr, pHash, (char)(0x80 | ((cp >> 6) & 0x3f)));
+            put(pStr, pHash, (char)(0x80 | (cp & 0x3f)));
+        }
+    }
+
+    bool skipValue() {
+        int c = skipWhitespace();
+        if (c == '"') {
+            return readString(nullptr);
+        }
+        if (c != '{' && c != '[') {
+            // number, boolean or null
+            while (c != -1 && c != ',' && c != '}' && c != ']' && c != ' ' && c != '\t' &&
+                   c != '\r' && c != '\n') {
+                next();
+                c = peek();
+            }
+            return true;
+        }
+        int depth = 0;
+        while ((c = peek()) != -1) {
+            if (c == '"') {
+                if (!readString(nullptr)) {
+                    return false;
+                }
+                continue;
+            }
+            next();
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool findMember(const jsonpath &keypath, unsigned int level, String &value) {
+        if (skipWhitespace() != '{') {
+            return false;
+        }
+        next();
+        String key;
+        while (skipWhitespace() == '"') {
+            key = "";
+            uint32_t hash = jsonpath::hashOf("");
+            if (!readString(&key, &hash) || skipWhitespace() != ':') {
+                return false;
+            }
+            next();
+            if (hash == keypath.hash(level) && key == keypath[level]) {
+                if (level < keypath.length() - 1) {
+                    return findMember(keypath, level + 1, value);
+                }
+                skipWhitespace();
+                value = "";
+                pCapture = &value;
+                bool found = skipValue();
+                pCapture = nullptr;
+                return found;
+            }
+            if (!skipValue() || skipWhitespace() != ',') {
+                // end of object or malformed
+                return false;
+            }
+            next();
+        }
+        return false;
+    }
+};
+
+/*! \brief muwerk JSON MessagePack Class
+
+Converts JSON documents to and from the binary MessagePack format. It is used
+by \ref jsonfile, if `JSONFILE_MSGPACK` is defined. MessagePack files are
+considerably smaller than the equivalent JSON text, and decoding them needs no
+text parsing: all lengths are known in advance, numbers are stored binary.
+
+Encoding walks the JSONVar tree and writes it with a \ref msgpackEncoder, no
+JSON text of the document is created. Decoding builds the JSONVar tree directly
+while a \ref msgpackDecoder reads the file in chunks of `JSONFILE_STREAM_CHUNK`
+bytes.
+*/
+class jsonmsgpack {
+  private:
+    typedef msgpackEncoder<fs::File, JSONFILE_STREAM_CHUNK> T_ENCODER;
+    typedef msgpackDecoder<fs::File, JSONFILE_STREAM_CHUNK> T_DECODER;
+    fs::File &f;
+
+  public:
+    jsonmsgpack(fs::File &f) : f(f) {
+        /*! Creates a MessagePack converter for an opened file
+        @param f File opened for writing (to encode) or reading (to decode)
+        */
+    }
+
+    bool encode(JSONVar &doc) {
+        /*! Write a JSON document as MessagePack to the file
+        @param doc The document
+        @return `true` on success.
+        */
+        T_ENCODER enc(f);
+        if (!encodeValue(enc, doc)) {
+            return false;
+        }
+        return enc.flush();
+    }
+
+    bool decode(JSONVar &target) {
+        /*! Read a MessagePack document from the file
+        @param target Receives the decoded document
+        @return `true` on success.
+        */
+        T_DECODER dec(f);
+        return decodeValue(dec, target);
+    }
+
+  private:
+    static bool encodeValue(T_ENCODER &enc, JSONVar &value) {
+        String type = JSON.typeof(value);
+        if (type == "object") {
+            JSONVar keys = value.keys();
+            enc.writeMap(keys.length());
+            for (int i = 0; i < keys.length(); i++) {
+                const char *key = keys[i];
+                enc.writeString(key);
+                JSONVar child = value[key];
+                if (!encodeValue(enc, child)) {
+                    return false;
+                }
+            }
+        } else if (type == "array") {
+            enc.writeArray(value.length());
+            for (int i = 0; i < value.length(); i++) {
+                JSONVar child = value[i];
+                if (!encodeValue(enc, child)) {
+                    return false;
+                }
+            }
+        } else if (type == "string") {
+            enc.writeString((const char *)value);
+        } else if (type == "number") {
+            double d = (double)value;
+            if (d >= -9.2e18 && d <= 9.2e18 && (double)(long long)d == d) {
+                enc.writeInt((long long)d);
+            } else {
+                enc.writeDouble(d);
+            }
+        } else if (type == "boolean") {
+            enc.writeBool((bool)value);
+        } else if (type == "null") {
+            enc.writeNil();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static bool decodeContainer(T_DECODER &dec, JSONVar &target, bool isMap, unsigned long n) {
+        // copy assignment: target keeps referring to the element in the document
+        JSONVar container = JSON.parse(isMap ? "{}" : "[]");
+        target = container;
+        String key;
+        for (unsigned long i = 0; i < n; i++) {
+            if (isMap) {
+                // only string keys are supported
+                if (dec.read() != T_DECODER::STRING || !dec.readString(key)) {
+                    return false;
+                }
+                JSONVar child = target[key.c_str()];
+                if (!decodeValue(dec, child)) {
+                    return false;
+                }
+            } else {
+                JSONVar child = target[(int)i];
+                if (!decodeValue(dec, child)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static bool decodeValue(T_DECODER &dec, JSONVar &target) {
+        switch (dec.read()) {
+        case T_DECODER::NIL: {
+            JSONVar null = JSON.parse("null");
+            target = null;
+            return true;
+        }
+        case T_DECODER::BOOLEAN:
+            target = dec.boolean();
+            return true;
+        case T_DECODER::INTEGER:
+            if (dec.integer() >= LONG_MIN && dec.integer() <= LONG_MAX) {
+                target = (long)dec.integer();
+            } else {
+                target = (double)dec.integer();
+            }
+            return true;
+        case T_DECODER::FLOAT:
+            target = dec.number();
+            return true;
+        case T_DECODER::STRING: {
+            String s;
+            if (!dec.readString(s)) {
+                return false;
+            }
+            target = s;
+            return true;
+        }
+        case T_DECODER::ARRAY:
+            return decodeContainer(dec, target, false, dec.length());
+        case T_DECODER::MAP:
+            return decodeContainer(dec, target, true, dec.length());
+        default:
+            return false;
+        }
+    }
+};
+
 /*! \brief muwerk JSON File Class
 
 Implements a class that allows to easyly manage files that contain information
@@ -29,11 +465,55 @@ when creating the instance (default: `true`).
 This class implements also a set of static functions that allow to perform
 atomic operations on JSON files.
 
+Parsed documents are kept in a process-wide cache that is shared by all
+instances (and therefore by all atomic operations): as long as a file is
+not modified, reading it again costs only a lookup in the already parsed
+tree instead of reading and parsing the whole file. A cached document is
+discarded when any instance commits to the same file. Changes made to the
+file by other means are detected by its size and modification time, which
+are checked at most every `JSONFILE_CACHE_VERIFY` milliseconds (default:
+1000). The total size of the cached files is limited by `JSONFILE_CACHE_SIZE`
+(default: 8192 bytes, `0` disables the cache). Since a parsed tree needs 5-10
+times the memory of the file, the cache is disabled by default on ESP8266 and
+on platforms with less than 8k of memory.
+
+Files larger than `JSONFILE_STREAM_SIZE` (default: 4096 bytes or
+`JSONFILE_CACHE_SIZE`, whichever is larger) are not loaded for reading: each
+read extracts the requested value directly from the file with a \ref
+jsonstreamreader, so that large files can be read on devices with little
+memory. The whole document is only loaded when it is modified.
+
+With `autocommit` enabled, every write rewrites the whole file. Code that
+changes several values in a row can enable a write-back mode with \ref
+enableWriteBack: writes only mark the document as modified and a scheduler
+task commits it once after a quiet period without further writes. Pending
+changes are also committed by \ref flush, when the instance is destroyed or
+switches to another file, and by \ref flushAll, which is called before
+the device is restarted by the console or the doctor.
+
+Files are committed crash-safe: the content is written to a temporary file
+`<filename>.json.tmp` that replaces the original file by renaming it, so a
+reset during a commit never leaves a truncated file behind. Frequent small
+updates can additionally be recorded in an append-only update log (see
+\ref enableUpdateLog): each write appends one line with the key and the new
+value to `<filename>.log` instead of rewriting the whole file. The log is
+replayed when the file is loaded and compacted into the file by a regular
+commit after a configurable number of entries.
+
+If `JSONFILE_MSGPACK` is defined, documents are stored in the binary
+MessagePack format in `<filename>.msgpack` (see \ref jsonmsgpack), which is
+smaller and faster to load. The key-path API is the same, existing
+`<filename>.json` files are migrated automatically when they are accessed
+for the first time. \ref exportJson (and the console command `jf export`)
+provides the content as JSON text.
+
 Values are referenced by a `key`. This `key` is an MQTT-topic-like path,
 structured like this: `filename/a/b/c/d`. e.G.: when reading a value by
 specifying this key, the corresponding function will read the JSON file
 `/filename.json` containg the  example content `{"a": {"b": {"c": {"d": false}}}}`
-and wil return the value `false`.
+and wil return the value `false`. Keys that are used frequently can be
+compiled once into a \ref jsonpath, which is accepted by all functions in
+place of the key.
 
 ### Example of reading multiple values
 
@@ -68,10 +548,36 @@ class jsonfile {
   private:
     bool loaded = false;
     bool forcenew = false;
+    bool streamed = false;
     bool autocommit = true;
+    bool dirty = false;
     String path = "/";
     String filename = "";
     JSONVar obj;
+    JSONVar *pShared = nullptr;
+
+    // write-back mode
+    Scheduler *pSched = nullptr;
+    int tID = -1;
+    unsigned long quietPeriod = 0;
+    unsigned long lastWrite = 0;
+
+    // update log
+    unsigned int logMax = 0;
+    unsigned int logEntries = 0;
+
+#if JSONFILE_CACHE_SIZE > 0
+    typedef struct {
+        String fn;
+        size_t size;
+        time_t mtime;
+        JSONVar *pDoc;
+        unsigned int refs;
+        unsigned long lastUse;
+        unsigned long verified;
+        bool stale;
+    } T_DOCCACHE;
+#endif
 
   public:
     jsonfile(bool auto_commit = true, bool force_new = false, String path = "/")
@@ -87,6 +593,42 @@ class jsonfile {
         obj = JSON.parse("{}");
     }
 
+    jsonfile(const jsonfile &src)
+        : loaded(src.loaded), forcenew(src.forcenew), streamed(src.streamed),
+          autocommit(src.autocommit), path(src.path), filename(src.filename), obj(src.obj),
+          logMax(src.logMax), logEntries(src.logEntries) {
+        /*! Creates a copy of a JSON file manager
+        @param src Source JSON file manager
+        */
+        share(src.pShared);
+    }
+
+    ~jsonfile() {
+        disableWriteBack();
+        release();
+    }
+
+    jsonfile &operator=(const jsonfile &src) {
+        /*! Assigns the content of another JSON file manager
+        @param src Source JSON file manager
+        */
+        if (this != &src) {
+            flush();
+            release();
+            loaded = src.loaded;
+            forcenew = src.forcenew;
+            streamed = src.streamed;
+            autocommit = src.autocommit;
+            path = src.path;
+            filename = src.filename;
+            obj = src.obj;
+            logMax = src.logMax;
+            logEntries = src.logEntries;
+            share(src.pShared);
+        }
+        return *this;
+    }
+
     void clear(bool auto_commit = true, bool force_new = false) {
         /*! Clear the JSON file manager
         @param auto_commit (optional, default is `true`) If set to `false`, all write operations
@@ -94,11 +636,14 @@ class jsonfile {
         @param force_new (optional, default is `false`) If set to `true`, a new file will be
                          created instead of changing the existing one.
         */
+        flush();
+        release();
         filename = "";
         obj = JSON.parse("{}");
         autocommit = auto_commit;
         forcenew = force_new;
         loaded = false;
+        streamed = false;
     }
 
     bool init(String basename, JSONVar &value, bool auto_commit = true) {
@@ -110,12 +655,15 @@ class jsonfile {
                            method \ref commit
         @return `true` on success.
         */
+        flush();
+        release();
         filename = basename;
         obj = value;
         autocommit = auto_commit;
         forcenew = true;
         loaded = false;
-        return autocommit ? commit() : true;
+        streamed = false;
+        return autoCommit();
     }
 
     bool init(String basename, String value, bool auto_commit = true) {
@@ -142,16 +690,85 @@ class jsonfile {
         if (result) {
             autocommit = auto_commit;
             forcenew = true;
-            return autocommit ? commit() : true;
+            return autoCommit();
         }
         return false;
     }
 
+    bool enableWriteBack(Scheduler *_pSched, unsigned long quietPeriodMs = 2000) {
+        /*! Enable the write-back mode
+        In write-back mode, writes with `autocommit` enabled do not rewrite the file
+        immediately, they are committed by a scheduler task as soon as no further write
+        occurred for the quiet period. The instance must exist as long as the write-back mode
+        is enabled, copies of the instance do not inherit it.
+        @param _pSched Pointer to the muwerk scheduler.
+        @param quietPeriodMs (optional, default is 2000) Time without writes in milliseconds
+                             after which pending changes are committed.
+        @return `true` on success.
+        */
+        disableWriteBack();
+        tID = _pSched->add([this]() { this->writeBackLoop(); }, "jsonfile", 100000L);
+        if (tID == -1) {
+            return false;
+        }
+        pSched = _pSched;
+        quietPeriod = quietPeriodMs;
+        writeBackInstances().add(this);
+        return true;
+    }
+
+    void disableWriteBack() {
+        /*! Disable the write-back mode. Pending changes are committed. */
+        if (!pSched) {
+            return;
+        }
+        flush();
+        ustd::array<jsonfile *> &instances = writeBackInstances();
+        for (unsigned int i = 0; i < instances.length(); i++) {
+            if (instances[i] == this) {
+                instances.erase(i);
+                break;
+            }
+        }
+        pSched->remove(tID);
+        pSched = nullptr;
+        tID = -1;
+    }
+
+    void enableUpdateLog(unsigned int maxEntries = 32) {
+        /*! Enable the append-only update log
+        With the update log enabled, writes with `autocommit` enabled append the changed value
+        to the log file `<filename>.log` instead of rewriting the whole file. The log is
+        replayed when the file is loaded. When the log contains `maxEntries` entries, it is
+        compacted by committing the whole file. The write-back mode (see \ref
+        enableWriteBack) takes precedence over the update log.
+        @param maxEntries (optional, default is 32) Number of log entries after which the log is
+                          compacted. `0` disables the update log.
+        */
+        logMax = maxEntries;
+    }
+
+    bool flush() {
+        /*! Commit pending changes of the write-back mode immediately
+        @return `true` on success or if there were no pending changes.
+        */
+        return dirty ? commit() : true;
+    }
+
+    static void flushAll() {
+        /*! Commit the pending changes of all instances in write-back mode, e.g. before
+        restarting the device. */
+        ustd::array<jsonfile *> &instances = writeBackInstances();
+        for (unsigned int i = 0; i < instances.length(); i++) {
+            instances[i]->flush();
+        }
+    }
+
     String toString() const {
         /*! Returns the content of the JSON file manager as String in JSON format.
         @return The content of the JSON file manager as String in JSON format.
         */
-        return JSON.stringify(obj);
+        return JSON.stringify(pShared ? *pShared : obj);
     }
 
     bool commit() {
@@ -164,37 +781,63 @@ class jsonfile {
             DBG("Cannot commit uninitialized object");
             return false;
         }
-        String jsonString = JSON.stringify(obj);
-
-        DBG2("Writing file: " + path + filename + ".json, content: " + jsonString);
-
-        fs::File f = fsOpen(path + filename + ".json", "w");
+        if (streamed) {
+            // nothing was loaded, so nothing was changed
+            return true;
+        }
+        String fn = docFile(filename);
+        fs::File f = fsOpen(fn + ".tmp", "w");
         if (!f) {
-            DBG("File " + path + filename + ".json can't be opened for write, failure.");
+            DBG("File " + fn + ".tmp can't be opened for write, failure.");
             return false;
-        } else {
-            f.print(jsonString.c_str());
-            f.close();
-            forcenew = false;
-            return true;
         }
+#ifdef JSONFILE_MSGPACK
+        DBG2("Writing file: " + fn);
+        jsonmsgpack mp(f);
+        bool written = mp.encode(doc());
+#else
+        String jsonString = JSON.stringify(doc());
+        DBG2("Writing file: " + fn + ", content: " + jsonString);
+        bool written = f.print(jsonString.c_str()) == jsonString.length();
+#endif
+        f.close();
+        if (!written || !fsRename(fn + ".tmp", fn)) {
+            DBG("File " + fn + " can't be written, failure.");
+            fsDelete(fn + ".tmp");
+            return false;
+        }
+        cacheInvalidate(fn);
+        // the committed content includes all logged updates
+        if (fsExists(path + filename + ".log")) {
+            fsDelete(path + filename + ".log");
+        }
+#ifdef JSONFILE_MSGPACK
+        // migration from json is complete
+        if (fsExists(path + filename + ".json")) {
+            fsDelete(path + filename + ".json");
+            cacheInvalidate(path + filename + ".json");
+        }
+#endif
+        logEntries = 0;
+        forcenew = false;
+        dirty = false;
+        return true;
     }
 
-    bool exists(String key) {
+    bool exists(const jsonpath &key) {
         /*! Test if a value exists in a JSON-file.
         @param key Combined filename and json-object-path.
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (prepareRead(key, keyparts, subobj)) {
-            DBG2("From " + key + ", element found.");
+        if (prepareRead(key, subobj)) {
+            DBG2("From " + key.toString() + ", element found.");
             return true;
         };
         return false;
     }
 
-    static bool atomicExists(String key) {
+    static bool atomicExists(const jsonpath &key) {
         /*! Test if a value exists in a JSON-file.
         @param key Combined filename and json-object-path.
         @return `true` on success.
@@ -203,7 +846,40 @@ class jsonfile {
         return jf.exists(key);
     }
 
-    bool remove(String key) {
+    unsigned int readBatch(jsonbatch &batch) {
+        /*! Read all values of a batch of keys.
+        The documents are traversed once, keys with a common prefix share the lookup of
+        their common parent objects.
+        @param batch The keys with their target variables, see \ref jsonbatch.
+        @return Number of values found, values not found receive their default value.
+        */
+        unsigned int found = 0;
+        unsigned int first = 0;
+        while (first < batch.length()) {
+            // keys of the same file
+            unsigned int last = batch.groupEnd(first, batch.length(), 0);
+            const jsonpath &key = batch.entries[first]->key;
+            if (!checkLoad(key[0])) {
+                DBG2("From " + key.toString() + ", file not found.");
+                batch.assignDefault(first, last);
+            } else {
+                found += readMembers(doc(), batch, first, last, 1);
+            }
+            first = last;
+        }
+        return found;
+    }
+
+    static unsigned int atomicReadBatch(jsonbatch &batch) {
+        /*! Read all values of a batch of keys.
+        @param batch The keys with their target variables, see \ref jsonbatch.
+        @return Number of values found, values not found receive their default value.
+        */
+        jsonfile jf;
+        return jf.readBatch(batch);
+    }
+
+    bool remove(const jsonpath &key) {
         /*! Remove a value from a JSON-file.
         @param key Combined filename and json-object-path.
         @return `true` on success.
@@ -213,10 +889,10 @@ class jsonfile {
             return false;
         }
         target = undefined;
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicRemove(String key) {
+    static bool atomicRemove(const jsonpath &key) {
         /*! Remove a value from a JSON-file.
         @param key Combined filename and json-object-path.
         @return `true` on success.
@@ -225,7 +901,7 @@ class jsonfile {
         return jf.remove(key);
     }
 
-    bool readJsonVar(String key, JSONVar &value) {
+    bool readJsonVar(const jsonpath &key, JSONVar &value) {
         /*! Read a JSON value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param value JSONVar variable that will receive the read value if found.
@@ -233,14 +909,15 @@ class jsonfile {
                      found, it may be initialized with the default value.
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
-        if (!prepareRead(key, keyparts, value)) {
+        JSONVar subobj;
+        if (!prepareRead(key, subobj)) {
             return false;
         }
+        value = subobj;
         return true;
     }
 
-    static bool atomicReadJsonVar(String key, JSONVar &value) {
+    static bool atomicReadJsonVar(const jsonpath &key, JSONVar &value) {
         /*! Read a JSON value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param value JSONVar variable that will receive the read value if found.
@@ -252,7 +929,7 @@ class jsonfile {
         return jf.readJsonVar(key, value);
     }
 
-    bool readJsonVarArray(String key, ustd::array<JSONVar> &values) {
+    bool readJsonVarArray(const jsonpath &key, ustd::array<JSONVar> &values) {
         /*! Read an array of JSON values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of JSONVar that will receive the read value if found.
@@ -260,13 +937,12 @@ class jsonfile {
                       found, it may be initialized with the default value.
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return false;
         }
         if (JSON.typeof(subobj) != "array") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'array'");
             return false;
         }
@@ -278,7 +954,7 @@ class jsonfile {
         return true;
     }
 
-    static bool atomicReadJsonVarArray(String key, ustd::array<JSONVar> &values) {
+    static bool atomicReadJsonVarArray(const jsonpath &key, ustd::array<JSONVar> &values) {
         /*! Read an array of JSON values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of JSONVar that will receive the read value if found.
@@ -290,7 +966,7 @@ class jsonfile {
         return jf.readJsonVarArray(key, values);
     }
 
-    bool readStringArray(String key, ustd::array<String> &values, bool strict = false) {
+    bool readStringArray(const jsonpath &key, ustd::array<String> &values, bool strict = false) {
         /*! Read an array of strings from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of strings that will receive the read value if found.
@@ -300,13 +976,12 @@ class jsonfile {
                       if the array contains any values that are not of type `string`
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return false;
         }
         if (JSON.typeof(subobj) != "array") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'array'");
             return false;
         }
@@ -314,8 +989,8 @@ class jsonfile {
             // check that all elements are strings
             for (int i = 0; i < subobj.length(); i++) {
                 if (JSON.typeof(subobj[i]) != "string") {
-                    DBG("From " + key + ", array element " + String(i) + " has wrong type '" +
-                        JSON.typeof(subobj[i]) + "' - expected 'string'");
+                    DBG("From " + key.toString() + ", array element " + String(i) +
+                        " has wrong type '" + JSON.typeof(subobj[i]) + "' - expected 'string'");
                     return false;
                 }
             }
@@ -327,7 +1002,7 @@ class jsonfile {
         return true;
     }
 
-    static bool atomicReadStringArray(String key, ustd::array<String> &values,
+    static bool atomicReadStringArray(const jsonpath &key, ustd::array<String> &values,
                                       bool strict = false) {
         /*! Read an array of strings from a JSON-File.
         @param key Combined filename and json-object-path.
@@ -342,7 +1017,7 @@ class jsonfile {
         return jf.readStringArray(key, values, strict);
     }
 
-    bool readBoolArray(String key, ustd::array<bool> &values, bool strict = false) {
+    bool readBoolArray(const jsonpath &key, ustd::array<bool> &values, bool strict = false) {
         /*! Read an array of boolean values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of bool that will receive the read value if found.
@@ -352,13 +1027,12 @@ class jsonfile {
                       if the array contains any values that are not of type `boolean`
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return false;
         }
         if (JSON.typeof(subobj) != "array") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'array'");
             return false;
         }
@@ -366,8 +1040,8 @@ class jsonfile {
             // check that all elements are bools
             for (int i = 0; i < subobj.length(); i++) {
                 if (JSON.typeof(subobj[i]) != "boolean") {
-                    DBG("From " + key + ", array element " + String(i) + " has wrong type '" +
-                        JSON.typeof(subobj[i]) + "' - expected 'boolean'");
+                    DBG("From " + key.toString() + ", array element " + String(i) +
+                        " has wrong type '" + JSON.typeof(subobj[i]) + "' - expected 'boolean'");
                     return false;
                 }
             }
@@ -379,7 +1053,8 @@ class jsonfile {
         return true;
     }
 
-    static bool atomicReadBoolArray(String key, ustd::array<bool> &values, bool strict = false) {
+    static bool atomicReadBoolArray(const jsonpath &key, ustd::array<bool> &values,
+                                    bool strict = false) {
         /*! Read an array of boolean values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of bool that will receive the read value if found.
@@ -393,7 +1068,7 @@ class jsonfile {
         return jf.readBoolArray(key, values, strict);
     }
 
-    bool readDoubleArray(String key, ustd::array<double> &values, bool strict = false) {
+    bool readDoubleArray(const jsonpath &key, ustd::array<double> &values, bool strict = false) {
         /*! Read an array of double precision values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of double that will receive the read value if found.
@@ -403,13 +1078,12 @@ class jsonfile {
                       if the array contains any values that are not of type `number`
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return false;
         }
         if (JSON.typeof(subobj) != "array") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'array'");
             return false;
         }
@@ -417,8 +1091,8 @@ class jsonfile {
             // check that all elements are bools
             for (int i = 0; i < subobj.length(); i++) {
                 if (JSON.typeof(subobj[i]) != "number") {
-                    DBG("From " + key + ", array element " + String(i) + " has wrong type '" +
-                        JSON.typeof(subobj[i]) + "' - expected 'number'");
+                    DBG("From " + key.toString() + ", array element " + String(i) +
+                        " has wrong type '" + JSON.typeof(subobj[i]) + "' - expected 'number'");
                     return false;
                 }
             }
@@ -430,7 +1104,7 @@ class jsonfile {
         return true;
     }
 
-    static bool atomicReadDoubleArray(String key, ustd::array<double> &values,
+    static bool atomicReadDoubleArray(const jsonpath &key, ustd::array<double> &values,
                                       bool strict = false) {
         /*! Read an array of double precision values from a JSON-File.
         @param key Combined filename and json-object-path.
@@ -445,7 +1119,7 @@ class jsonfile {
         return jf.readDoubleArray(key, values, strict);
     }
 
-    bool readLongArray(String key, ustd::array<long> &values, bool strict = false) {
+    bool readLongArray(const jsonpath &key, ustd::array<long> &values, bool strict = false) {
         /*! Read an array of long integer values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of long that will receive the read value if found.
@@ -455,13 +1129,12 @@ class jsonfile {
                       if the array contains any values that are not of type `number`
         @return `true` on success.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return false;
         }
         if (JSON.typeof(subobj) != "array") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'array'");
             return false;
         }
@@ -469,8 +1142,8 @@ class jsonfile {
             // check that all elements are bools
             for (int i = 0; i < subobj.length(); i++) {
                 if (JSON.typeof(subobj[i]) != "number") {
-                    DBG("From " + key + ", array element " + String(i) + " has wrong type '" +
-                        JSON.typeof(subobj[i]) + "' - expected 'number'");
+                    DBG("From " + key.toString() + ", array element " + String(i) +
+                        " has wrong type '" + JSON.typeof(subobj[i]) + "' - expected 'number'");
                     return false;
                 }
             }
@@ -482,7 +1155,8 @@ class jsonfile {
         return true;
     }
 
-    static bool atomicReadLongArray(String key, ustd::array<long> &values, bool strict = false) {
+    static bool atomicReadLongArray(const jsonpath &key, ustd::array<long> &values,
+                                    bool strict = false) {
         /*! Read an array of long integer values from a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of long that will receive the read value if found.
@@ -496,28 +1170,27 @@ class jsonfile {
         return jf.readLongArray(key, values, strict);
     }
 
-    bool readBool(String key, bool defaultVal) {
+    bool readBool(const jsonpath &key, bool defaultVal) {
         /*! Read a boolean value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
         @return The requested value or `defaultVal` if value not found.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return defaultVal;
         }
         if (JSON.typeof(subobj) != "boolean") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'boolean'");
             return defaultVal;
         }
         bool result = (bool)subobj;
-        DBG2("From " + key + ", value: " + (result ? "true" : "false"));
+        DBG2("From " + key.toString() + ", value: " + (result ? "true" : "false"));
         return result;
     }
 
-    static bool atomicReadBool(String key, bool defaultVal) {
+    static bool atomicReadBool(const jsonpath &key, bool defaultVal) {
         /*! Read a boolean value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
@@ -527,28 +1200,27 @@ class jsonfile {
         return jf.readBool(key, defaultVal);
     }
 
-    String readString(String key, String defaultVal = "") {
+    String readString(const jsonpath &key, String defaultVal = "") {
         /*! Read a string value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
         @return The requested value or `defaultVal` if value not found.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return defaultVal;
         }
         if (JSON.typeof(subobj) != "string") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'string'");
             return defaultVal;
         }
         String result = (const char *)subobj;
-        DBG2("From " + key + ", value: " + result);
+        DBG2("From " + key.toString() + ", value: " + result);
         return result;
     }
 
-    static String atomicReadString(String key, String defaultVal = "") {
+    static String atomicReadString(const jsonpath &key, String defaultVal = "") {
         /*! Read a string value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
@@ -558,7 +1230,7 @@ class jsonfile {
         return jf.readString(key, defaultVal);
     }
 
-    String readString(String key, unsigned int minLength, String defaultVal = "") {
+    String readString(const jsonpath &key, unsigned int minLength, String defaultVal = "") {
         /*! Read a string value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param minLength Minimum acceptable string length.
@@ -569,7 +1241,8 @@ class jsonfile {
         return val.length() < minLength ? defaultVal : val;
     }
 
-    static String atomicReadString(String key, unsigned int minLength, String defaultVal = "") {
+    static String atomicReadString(const jsonpath &key, unsigned int minLength,
+                                   String defaultVal = "") {
         /*! Read a string value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param minLength Minimum acceptable string length.
@@ -580,28 +1253,27 @@ class jsonfile {
         return jf.readString(key, minLength, defaultVal);
     }
 
-    double readDouble(String key, double defaultVal) {
+    double readDouble(const jsonpath &key, double defaultVal) {
         /*! Read a number value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
         @return The requested value or `defaultVal` if value not found.
         */
-        ustd::array<String> keyparts;
         JSONVar subobj;
-        if (!prepareRead(key, keyparts, subobj)) {
+        if (!prepareRead(key, subobj)) {
             return defaultVal;
         }
         if (JSON.typeof(subobj) != "number") {
-            DBG("From " + key + ", element has wrong type '" + JSON.typeof(subobj) +
+            DBG("From " + key.toString() + ", element has wrong type '" + JSON.typeof(subobj) +
                 "' - expected 'number'");
             return defaultVal;
         }
         double result = (double)subobj;
-        DBG2("From " + key + ", value: " + String(result));
+        DBG2("From " + key.toString() + ", value: " + String(result));
         return result;
     }
 
-    static double atomicReadDouble(String key, double defaultVal) {
+    static double atomicReadDouble(const jsonpath &key, double defaultVal) {
         /*! Read a number value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
@@ -611,7 +1283,7 @@ class jsonfile {
         return jf.readDouble(key, defaultVal);
     }
 
-    double readDouble(String key, double minVal, double maxVal, double defaultVal) {
+    double readDouble(const jsonpath &key, double minVal, double maxVal, double defaultVal) {
         /*! Read a number value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param minVal minimum accepatable value.
@@ -624,7 +1296,8 @@ class jsonfile {
         return (val < minVal || val > maxVal) ? defaultVal : val;
     }
 
-    static double atomicReadDouble(String key, double minVal, double maxVal, double defaultVal) {
+    static double atomicReadDouble(const jsonpath &key, double minVal, double maxVal,
+                                   double defaultVal) {
         /*! Read a number value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param minVal minimum accepatable value.
@@ -637,7 +1310,7 @@ class jsonfile {
         return jf.readDouble(key, minVal, maxVal, defaultVal);
     }
 
-    long readLong(String key, long defaultVal) {
+    long readLong(const jsonpath &key, long defaultVal) {
         /*! Read a long integer value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
@@ -646,7 +1319,7 @@ class jsonfile {
         return (long)readDouble(key, (double)defaultVal);
     }
 
-    static long atomicReadLong(String key, long defaultVal) {
+    static long atomicReadLong(const jsonpath &key, long defaultVal) {
         /*! Read a long integer value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param defaultVal value returned, if key is not found.
@@ -656,7 +1329,7 @@ class jsonfile {
         return jf.readLong(key, defaultVal);
     }
 
-    long readLong(String key, long minVal, long maxVal, long defaultVal) {
+    long readLong(const jsonpath &key, long minVal, long maxVal, long defaultVal) {
         /*! Read a long integer value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param minVal minimum accepatable value.
@@ -669,7 +1342,7 @@ class jsonfile {
         return (val < minVal || val > maxVal) ? defaultVal : val;
     }
 
-    static long atomicReadLong(String key, long minVal, long maxVal, long defaultVal) {
+    static long atomicReadLong(const jsonpath &key, long minVal, long maxVal, long defaultVal) {
         /*! Read a long integer value from a JSON-file.
         @param key Combined filename and json-object-path.
         @param minVal minimum accepatable value.
@@ -682,7 +1355,7 @@ class jsonfile {
         return jf.readLong(key, minVal, maxVal, defaultVal);
     }
 
-    bool writeJsonVar(String key, JSONVar &value) {
+    bool writeJsonVar(const jsonpath &key, JSONVar &value) {
         /*! Write a JSON value to a JSON-file.
         @param key Combined filename and json-object-path.
         @param value JSONVar variable that contains the value to be saved.
@@ -693,10 +1366,10 @@ class jsonfile {
             return false;
         }
         target = value;
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteJsonVar(String key, JSONVar &value) {
+    static bool atomicWriteJsonVar(const jsonpath &key, JSONVar &value) {
         /*! Write a JSON value to a JSON-file.
         @param key Combined filename and json-object-path.
         @param value JSONVar variable that contains the value to be saved.
@@ -706,7 +1379,7 @@ class jsonfile {
         return jf.writeJsonVar(key, value);
     }
 
-    bool writeJsonVar(String key, String value) {
+    bool writeJsonVar(const jsonpath &key, String value) {
         /*! Write a JSON value to a JSON-file.
         @param key Combined filename and json-object-path.
         @param value String containing a value in JSON format to be saved.
@@ -723,10 +1396,10 @@ class jsonfile {
             return false;
         }
         target = jv;
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteJsonVar(String key, String value) {
+    static bool atomicWriteJsonVar(const jsonpath &key, String value) {
         /*! Write a JSON value to a JSON-file.
         @param key Combined filename and json-object-path.
         @param value String containing a value in JSON format to be saved.
@@ -736,9 +1409,9 @@ class jsonfile {
         return jf.writeJsonVar(key, value);
     }
 
-    bool writeString(String key, String value) {
+    bool writeString(const jsonpath &key, String value) {
         /*! Write a string value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -747,12 +1420,12 @@ class jsonfile {
             return false;
         }
         target = (const char *)value.c_str();
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteString(String key, String value) {
+    static bool atomicWriteString(const jsonpath &key, String value) {
         /*! Write a string value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -760,7 +1433,7 @@ class jsonfile {
         return jf.writeString(key, value);
     }
 
-    bool writeStringArray(String key, ustd::array<String> &values) {
+    bool writeStringArray(const jsonpath &key, ustd::array<String> &values) {
         /*! Write an array of Strings to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -770,14 +1443,16 @@ class jsonfile {
         if (!prepareWrite(key, target)) {
             return false;
         }
-        target = JSON.parse("[]");
-        for (unsigned int i; i < values.length(); i++) {
+        // copy assignment: target keeps referring to the element in the document
+        JSONVar array = JSON.parse("[]");
+        target = array;
+        for (unsigned int i = 0; i < values.length(); i++) {
             target[i] = (const char *)values[i].c_str();
         }
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteStringArray(String key, ustd::array<String> &values) {
+    static bool atomicWriteStringArray(const jsonpath &key, ustd::array<String> &values) {
         /*! Write an array of Strings to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -787,9 +1462,9 @@ class jsonfile {
         return jf.writeStringArray(key, values);
     }
 
-    bool writeBool(String key, bool value) {
+    bool writeBool(const jsonpath &key, bool value) {
         /*! Write a boolean value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -798,12 +1473,12 @@ class jsonfile {
             return false;
         }
         target = value;
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteBool(String key, bool value) {
+    static bool atomicWriteBool(const jsonpath &key, bool value) {
         /*! Write a boolean value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -811,7 +1486,7 @@ class jsonfile {
         return jf.writeBool(key, value);
     }
 
-    bool writeBoolArray(String key, ustd::array<bool> &values) {
+    bool writeBoolArray(const jsonpath &key, ustd::array<bool> &values) {
         /*! Write an array of boolean values to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -821,14 +1496,16 @@ class jsonfile {
         if (!prepareWrite(key, target)) {
             return false;
         }
-        target = JSON.parse("[]");
-        for (unsigned int i; i < values.length(); i++) {
+        // copy assignment: target keeps referring to the element in the document
+        JSONVar array = JSON.parse("[]");
+        target = array;
+        for (unsigned int i = 0; i < values.length(); i++) {
             target[i] = values[i];
         }
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteBoolArray(String key, ustd::array<bool> &values) {
+    static bool atomicWriteBoolArray(const jsonpath &key, ustd::array<bool> &values) {
         /*! Write an array of boolean values to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -838,9 +1515,9 @@ class jsonfile {
         return jf.writeBoolArray(key, values);
     }
 
-    bool writeDouble(String key, double value) {
+    bool writeDouble(const jsonpath &key, double value) {
         /*! Write a numerical value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -849,12 +1526,12 @@ class jsonfile {
             return false;
         }
         target = value;
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteDouble(String key, double value) {
+    static bool atomicWriteDouble(const jsonpath &key, double value) {
         /*! Write a numerical value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -862,7 +1539,7 @@ class jsonfile {
         return jf.writeDouble(key, value);
     }
 
-    bool writeDoubleArray(String key, ustd::array<double> &values) {
+    bool writeDoubleArray(const jsonpath &key, ustd::array<double> &values) {
         /*! Write an array of numerical values to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -872,14 +1549,16 @@ class jsonfile {
         if (!prepareWrite(key, target)) {
             return false;
         }
-        target = JSON.parse("[]");
-        for (unsigned int i; i < values.length(); i++) {
+        // copy assignment: target keeps referring to the element in the document
+        JSONVar array = JSON.parse("[]");
+        target = array;
+        for (unsigned int i = 0; i < values.length(); i++) {
             target[i] = values[i];
         }
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteDoubleArray(String key, ustd::array<double> &values) {
+    static bool atomicWriteDoubleArray(const jsonpath &key, ustd::array<double> &values) {
         /*! Write an array of numerical values to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -889,9 +1568,9 @@ class jsonfile {
         return jf.writeDoubleArray(key, values);
     }
 
-    bool writeLong(String key, long value) {
+    bool writeLong(const jsonpath &key, long value) {
         /*! Write a long integer value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -900,12 +1579,12 @@ class jsonfile {
             return false;
         }
         target = value;
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteLong(String key, long value) {
+    static bool atomicWriteLong(const jsonpath &key, long value) {
         /*! Write a long integer value to a JSON-file.
-        @param key Combined filename and json-object-path. (maxdepth is limited to 9)
+        @param key Combined filename and json-object-path.
         @param value Value to be written.
         @return `true` on success.
         */
@@ -913,7 +1592,7 @@ class jsonfile {
         return jf.writeLong(key, value);
     }
 
-    bool writeLongArray(String key, ustd::array<long> &values) {
+    bool writeLongArray(const jsonpath &key, ustd::array<long> &values) {
         /*! Write an array of long integer values to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -923,14 +1602,16 @@ class jsonfile {
         if (!prepareWrite(key, target)) {
             return false;
         }
-        target = JSON.parse("[]");
-        for (unsigned int i; i < values.length(); i++) {
+        // copy assignment: target keeps referring to the element in the document
+        JSONVar array = JSON.parse("[]");
+        target = array;
+        for (unsigned int i = 0; i < values.length(); i++) {
             target[i] = values[i];
         }
-        return autocommit ? commit() : true;
+        return autoCommit(key, target);
     }
 
-    static bool atomicWriteLongArray(String key, ustd::array<long> &values) {
+    static bool atomicWriteLongArray(const jsonpath &key, ustd::array<long> &values) {
         /*! Write an array of long integer values to a JSON-File.
         @param key Combined filename and json-object-path.
         @param values Array of values to be written.
@@ -940,25 +1621,103 @@ class jsonfile {
         return jf.writeLongArray(key, values);
     }
 
+    bool exportJson(String basename, String &json) {
+        /*! Get the content of a file as JSON text, independent of the storage format.
+        @param basename The basename of the file.
+        @param json Receives the content of the file in JSON format.
+        @return `true` on success.
+        */
+        if (!checkLoad(basename.c_str())) {
+            return false;
+        }
+        json = toString();
+        return true;
+    }
+
   private:
-    bool loadFile(String basename, String fn) {
+    String docFile(const String &basename) const {
+        return path + basename + JSONFILE_EXT;
+    }
+
+    bool loadFile(String basename, String fn, bool allowStream = false) {
         filename = basename;
+        streamed = false;
+        logEntries = 0;
+        release();
+        String logfn = "";
+        bool binary = fn.endsWith(".msgpack");
+#if JSONFILE_CACHE_SIZE > 0
+        if (cacheLookup(fn)) {
+            // recently verified, no file system access at all
+            DBG3("Input file " + fn + " served from cache");
+            loaded = true;
+            return true;
+        }
+#endif
+        if (fn == path + basename + ".json" || fn == path + basename + ".msgpack") {
+            if (!fsExists(fn) && fsExists(fn + ".tmp")) {
+                // interrupted commit: the temporary file is complete
+                DBG("Recovering " + fn + " from temporary file");
+                fsRename(fn + ".tmp", fn);
+            }
+            if (fsExists(path + basename + ".log")) {
+                logfn = path + basename + ".log";
+            }
+        }
         fs::File f = fsOpen(fn, "r");
         if (!f) {
             return false;
         }
-        String jsonstr = "";
-        if (!f.available()) {
+        size_t size = f.size();
+        if (allowStream && !binary && size > JSONFILE_STREAM_SIZE && logfn == "") {
+            f.close();
+            DBG3("Input file " + fn + " is read in streaming mode");
+            streamed = true;
+            return true;
+        }
+#if JSONFILE_CACHE_SIZE > 0
+        time_t mtime = f.getLastWrite();
+        if (logfn == "" && cacheAcquire(fn, size, mtime)) {
+            f.close();
+            DBG3("Input file " + fn + " served from cache");
+            loaded = true;
+            return true;
+        }
+#endif
+        if (!size) {
             DBG2("Opened " + fn + ", but no data in file!");
             return false;
         }
-        while (f.available()) {
-            // Lets read line by line from the file
-            String line = f.readStringUntil('\n');
-            jsonstr += line;
-        }
+        JSONVar content;
+        bool parsed = binary ? readMsgpack(f, fn, content) : readJson(f, size, fn, content);
         f.close();
-        JSONVar content = JSON.parse(jsonstr);
+        if (!parsed) {
+            return false;
+        }
+        if (logfn != "") {
+            replayLog(logfn, content);
+        }
+#if JSONFILE_CACHE_SIZE > 0
+        if (logfn == "" && cacheInsert(fn, size, mtime, content)) {
+            loaded = true;
+            return true;
+        }
+#endif
+        obj = content;
+        loaded = true;
+        return true;
+    }
+
+    bool readJson(fs::File &f, size_t size, const String &fn, JSONVar &content) {
+        String jsonstr = "";
+        jsonstr.reserve(size);
+        char buf[JSONFILE_STREAM_CHUNK + 1];
+        size_t len;
+        while ((len = f.read((uint8_t *)buf, JSONFILE_STREAM_CHUNK)) > 0) {
+            buf[len] = 0;
+            jsonstr += buf;
+        }
+        content = JSON.parse(jsonstr);
         if (JSON.typeof(content) == "undefined") {
             DBG("Parsing input file " + fn + "failed, invalid JSON!");
             DBG2("Content: " + jsonstr);
@@ -966,116 +1725,434 @@ class jsonfile {
         }
         DBG2("Input file " + fn + " successfully parsed");
         DBG3("Content: " + jsonstr);
-        obj = content;
-        loaded = true;
         return true;
     }
 
-    bool checkLoad(String basename) {
-        if (basename != filename) {
+    bool readMsgpack(fs::File &f, const String &fn, JSONVar &content) {
+        jsonmsgpack mp(f);
+        if (!mp.decode(content)) {
+            DBG("Decoding input file " + fn + " failed, invalid MessagePack!");
+            return false;
+        }
+        DBG2("Input file " + fn + " successfully decoded");
+        return true;
+    }
+
+    bool checkLoad(const char *basename, bool allowStream = false) {
+        if (filename != basename) {
+            flush();
+            release();
             filename = basename;
             loaded = false;
+            streamed = false;
+        }
+        if (streamed && !allowStream) {
+            // modifications need the whole document
+            streamed = false;
         }
-        if (loaded || forcenew) {
+        if (loaded || forcenew || streamed) {
             return true;
         }
-        return loadFile(basename, path + basename + ".json");
+#ifdef JSONFILE_MSGPACK
+        String fn = docFile(basename);
+        if (!fsExists(fn) && !fsExists(fn + ".tmp") && fsExists(path + basename + ".json")) {
+            DBG("Migrating " + path + basename + ".json to " + fn);
+            return loadFile(basename, path + basename + ".json") && commit();
+        }
+#endif
+        return loadFile(basename, docFile(basename), allowStream);
     }
 
-    bool prepareRead(String key, ustd::array<String> &keyparts, JSONVar &subobj,
-                     bool objmode = false) {
-        normalize(key);
-        ustd::split(key, '/', keyparts);
-        if (keyparts.length() < (objmode ? 1 : 2)) {
-            DBG("Key-path too short, minimum needed is filename/topic, got: " + key);
+    bool streamRead(const jsonpath &key, JSONVar &subobj) {
+        fs::File f = fsOpen(docFile(filename), "r");
+        if (!f) {
             return false;
         }
-        if (!checkLoad(keyparts[0])) {
+        String raw;
+        jsonstreamreader reader(f);
+        bool found = reader.find(key, 1, raw);
+        f.close();
+        if (!found) {
+            DBG2("From " + key.toString() + ", element not found.");
             return false;
         }
-        JSONVar iterator(obj);
-        for (unsigned int i = 1; i < keyparts.length() - 1; i++) {
-            JSONVar tmpCopy(iterator[keyparts[i]]);
-            iterator = tmpCopy;
-            if (JSON.typeof(iterator) == "undefined") {
-                DBG2("From " + key + ", element " + keyparts[i] + " not found.");
-                return false;
-            }
-        }
-        String lastKey = keyparts[keyparts.length() - 1];
-        if (!iterator.hasOwnProperty(lastKey)) {
-            DBG2("From " + key + ", element " + lastKey + " not found.");
+        subobj = JSON.parse(raw);
+        if (JSON.typeof(subobj) == "undefined") {
+            DBG("From " + key.toString() + ", invalid JSON value: " + raw);
             return false;
-        } else {
-            JSONVar tmpCopy(iterator[lastKey]);
-            subobj = tmpCopy;
         }
         return true;
     }
 
-    bool prepareWrite(String key, JSONVar &target, bool objmode = false) {
-        ustd::array<String> keyparts;
-
-        normalize(key);
-        ustd::split(key, '/', keyparts);
-        if (keyparts.length() < (objmode ? 1 : 2)) {
-            DBG("Key-path too short, minimum needed is filename/topic, got: " + key);
+    bool prepareRead(const jsonpath &key, JSONVar &subobj, bool objmode = false) {
+        // subobj receives a reference into the document that is valid until the next write
+        if (key.length() < (objmode ? 1 : 2)) {
+            DBG("Key-path too short, minimum needed is filename/topic, got: " + key.toString());
             return false;
         }
-        if (keyparts.length() > MAX_FRICKEL_DEPTH) {
-            DBG("Key-path too long, maxdepth is " + String(MAX_FRICKEL_DEPTH) + ", got: " + key);
+        if (!checkLoad(key[0], key.length() > 1)) {
             return false;
         }
-        if (!checkLoad(keyparts[0]) && forcenew) {
-            DBG("Creating new file /" + keyparts[0] + ".json");
+        if (streamed) {
+            return streamRead(key, subobj);
+        }
+        if (key.length() == 1) {
+            // possible only in object mode
+            subobj = doc();
+            return true;
+        }
+        if (!find(doc(), key, 1, subobj)) {
+            DBG2("From " + key.toString() + ", element not found.");
+            return false;
         }
+        return true;
+    }
 
-        // frickel
-        switch (keyparts.length()) {
-        case 1:
+    bool prepareWrite(const jsonpath &key, JSONVar &target, bool objmode = false) {
+        if (key.length() < (objmode ? 1 : 2)) {
+            DBG("Key-path too short, minimum needed is filename/topic, got: " + key.toString());
+            return false;
+        }
+        if (!checkLoad(key[0]) && forcenew) {
+            DBG("Creating new file " + docFile(key[0]));
+        }
+        // copy on write: the shared document is never modified
+        detach();
+        if (key.length() == 1) {
             // possible only in object mode
             target = obj;
             return true;
-        case 2:
-            target = obj[keyparts[1]];
-            return true;
-        case 3:
-            target = obj[keyparts[1]][keyparts[2]];
-            return true;
-        case 4:
-            target = obj[keyparts[1]][keyparts[2]][keyparts[3]];
-            return true;
-        case 5:
-            target = obj[keyparts[1]][keyparts[2]][keyparts[3]][keyparts[4]];
-            return true;
-        case 6:
-            target = obj[keyparts[1]][keyparts[2]][keyparts[3]][keyparts[4]][keyparts[5]];
+        }
+        walk(obj, key, 1, target);
+        return true;
+    }
+
+    static bool find(JSONVar &root, const jsonpath &key, unsigned int first, JSONVar &target) {
+        // target must be empty, it receives a reference to the element
+        if (!root.hasOwnProperty(key[first])) {
+            return false;
+        }
+        target = root[key[first]];
+        for (unsigned int i = first + 1; i < key.length(); i++) {
+            if (!target.hasOwnProperty(key[i])) {
+                return false;
+            }
+            target = target[key[i]];
+        }
+        return true;
+    }
+
+    static unsigned int readMembers(JSONVar &node, jsonbatch &batch, unsigned int first,
+                                    unsigned int last, unsigned int level) {
+        // all keys in [first, last) share the segments below level
+        unsigned int found = 0;
+        while (first < last) {
+            const jsonpath &key = batch.entries[first]->key;
+            if (key.length() <= level) {
+                DBG("Key-path too short, minimum needed is filename/topic, got: " +
+                    key.toString());
+                batch.assignDefault(first, first + 1);
+                ++first;
+                continue;
+            }
+            unsigned int end = batch.groupEnd(first, last, level);
+            if (!node.hasOwnProperty(key[level])) {
+                DBG2("From " + key.toString() + ", element " + key[level] + " not found.");
+                batch.assignDefault(first, end);
+                first = end;
+                continue;
+            }
+            JSONVar child = node[key[level]];
+            for (; first < end && batch.entries[first]->key.length() == level + 1; first++) {
+                found += assignBatch(batch, first, child) ? 1 : 0;
+            }
+            if (first < end) {
+                found += readMembers(child, batch, first, end, level + 1);
+            }
+            first = end;
+        }
+        return found;
+    }
+
+    static bool assignBatch(jsonbatch &batch, unsigned int index, JSONVar &value) {
+        String type = JSON.typeof(value);
+        DBG2("From " + batch.entries[index]->key.toString() + ", value: " +
+             JSON.stringify(value));
+        if (type == "string") {
+            return batch.assign(index, type, (const char *)value, 0.0);
+        }
+        if (type == "boolean") {
+            return batch.assign(index, type, "", (bool)value ? 1.0 : 0.0);
+        }
+        return batch.assign(index, type, "", type == "number" ? (double)value : 0.0);
+    }
+
+    static void walk(JSONVar &root, const jsonpath &key, unsigned int first, JSONVar &target) {
+        // like find, but creates missing elements
+        target = root[key[first]];
+        for (unsigned int i = first + 1; i < key.length(); i++) {
+            target = target[key[i]];
+        }
+    }
+
+    bool autoCommit() {
+        if (!autocommit) {
             return true;
-        case 7:
-            target =
-                obj[keyparts[1]][keyparts[2]][keyparts[3]][keyparts[4]][keyparts[5]][keyparts[6]];
+        }
+        if (pSched) {
+            dirty = true;
+            lastWrite = millis();
             return true;
-        case 8:
-            target = obj[keyparts[1]][keyparts[2]][keyparts[3]][keyparts[4]][keyparts[5]]
-                        [keyparts[6]][keyparts[7]];
+        }
+        return commit();
+    }
+
+    bool autoCommit(const jsonpath &key, JSONVar &target) {
+        if (!autocommit || pSched || !logMax || forcenew) {
+            return autoCommit();
+        }
+        if (logEntries + 1 >= logMax) {
+            // compact the log
+            return commit();
+        }
+        String logfn = path + filename + ".log";
+        fs::File f = fsOpen(logfn, "a");
+        if (!f) {
+            return commit();
+        }
+        // <key below filename as json string> TAB <json value>, an empty value removes the
+        // key. json text contains neither tabs nor newlines, whatever the key segments hold.
+        JSONVar jkey = key.toString(1);
+        String entry = JSON.stringify(jkey) + "\t" + JSON.stringify(target) + "\n";
+        bool written = f.print(entry.c_str()) == entry.length();
+        f.close();
+        if (!written) {
+            return commit();
+        }
+        ++logEntries;
+        cacheInvalidate(docFile(filename));
+        return true;
+    }
+
+    void replayLog(String logfn, JSONVar &content) {
+        fs::File f = fsOpen(logfn, "r");
+        if (!f) {
+            return;
+        }
+        while (f.available()) {
+            String line = f.readStringUntil('\n');
+            int sep = line.indexOf('\t');
+            if (sep < 1) {
+                // empty or truncated entry
+                continue;
+            }
+            JSONVar jkey = JSON.parse(line.substring(0, sep));
+            if (JSON.typeof(jkey) != "string") {
+                DBG("Invalid key in " + logfn + ": " + line);
+                continue;
+            }
+            jsonpath key((const char *)jkey);
+            String value = line.substring(sep + 1);
+            JSONVar target;
+            if (value == "") {
+                // nothing to remove, if an element of the path is missing
+                if (find(content, key, 0, target)) {
+                    target = undefined;
+                }
+            } else {
+                JSONVar jv = JSON.parse(value);
+                if (JSON.typeof(jv) == "undefined") {
+                    DBG("Invalid entry in " + logfn + ": " + line);
+                    continue;
+                }
+                walk(content, key, 0, target);
+                target = jv;
+            }
+            ++logEntries;
+        }
+        f.close();
+        DBG2("Replayed " + String(logEntries) + " entries from " + logfn);
+    }
+
+    void writeBackLoop() {
+        if (dirty && timeDiff(lastWrite, millis()) >= quietPeriod) {
+            if (!commit()) {
+                // retry after another quiet period
+                lastWrite = millis();
+            }
+        }
+    }
+
+    static ustd::array<jsonfile *> &writeBackInstances() {
+        static ustd::array<jsonfile *> instances(4);
+        return instances;
+    }
+
+    JSONVar &doc() {
+        return pShared ? *pShared : obj;
+    }
+
+    void detach() {
+        if (pShared) {
+            obj = *pShared;
+            release();
+        }
+    }
+
+#if JSONFILE_CACHE_SIZE > 0
+    static ustd::array<T_DOCCACHE> &docCache() {
+        static ustd::array<T_DOCCACHE> cache(4);
+        return cache;
+    }
+
+    static unsigned long cacheTick() {
+        static unsigned long tick = 0;
+        return ++tick;
+    }
+
+    static void cachePurge(unsigned int i) {
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        if (cache[i].refs == 0) {
+            delete cache[i].pDoc;
+            cache.erase(i);
+        } else {
+            // still used by an instance, deleted on release
+            cache[i].stale = true;
+        }
+    }
+
+    static void cacheInvalidate(String fn) {
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        for (unsigned int i = 0; i < cache.length(); i++) {
+            if (!cache[i].stale && cache[i].fn == fn) {
+                DBG3("Dropping cached document " + fn);
+                cachePurge(i);
+                return;
+            }
+        }
+    }
+
+    bool cacheAcquire(String fn, size_t size, time_t mtime) {
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        for (unsigned int i = 0; i < cache.length(); i++) {
+            if (cache[i].stale || cache[i].fn != fn) {
+                continue;
+            }
+            if (cache[i].size != size || cache[i].mtime != mtime) {
+                // file has been changed behind our back
+                DBG3("Cached document " + fn + " is outdated");
+                cachePurge(i);
+                return false;
+            }
+            ++cache[i].refs;
+            cache[i].lastUse = cacheTick();
+            cache[i].verified = millis();
+            pShared = cache[i].pDoc;
             return true;
-        case 9:
-            target = obj[keyparts[1]][keyparts[2]][keyparts[3]][keyparts[4]][keyparts[5]]
-                        [keyparts[6]][keyparts[7]][keyparts[8]];
+        }
+        return false;
+    }
+
+    bool cacheLookup(String fn) {
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        for (unsigned int i = 0; i < cache.length(); i++) {
+            if (cache[i].stale || cache[i].fn != fn) {
+                continue;
+            }
+            if (timeDiff(cache[i].verified, millis()) >= JSONFILE_CACHE_VERIFY) {
+                // check size and modification time of the file first
+                return false;
+            }
+            ++cache[i].refs;
+            cache[i].lastUse = cacheTick();
+            pShared = cache[i].pDoc;
             return true;
-        default:
-            DBG("SERIOUS PROGRAMMING ERROR - MAX_FRICKEL_DEV higher than implemented support "
-                "in " __FILE__ " line number " +
-                String(__LINE__));
+        }
+        return false;
+    }
+
+    bool cacheInsert(String fn, size_t size, time_t mtime, JSONVar &content) {
+        if (size > JSONFILE_CACHE_SIZE) {
             return false;
         }
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        size_t total = size;
+        for (unsigned int i = 0; i < cache.length(); i++) {
+            if (!cache[i].stale) {
+                total += cache[i].size;
+            }
+        }
+        while (total > JSONFILE_CACHE_SIZE) {
+            // evict the least recently used document that is not in use
+            int lru = -1;
+            for (unsigned int i = 0; i < cache.length(); i++) {
+                if (!cache[i].stale && cache[i].refs == 0 &&
+                    (lru == -1 || cache[i].lastUse < cache[lru].lastUse)) {
+                    lru = i;
+                }
+            }
+            if (lru == -1) {
+                return false;
+            }
+            total -= cache[lru].size;
+            cachePurge(lru);
+        }
+        T_DOCCACHE entry;
+        entry.fn = fn;
+        entry.size = size;
+        entry.mtime = mtime;
+        entry.pDoc = new JSONVar(content);
+        entry.refs = 1;
+        entry.lastUse = cacheTick();
+        entry.verified = millis();
+        entry.stale = false;
+        if (cache.add(entry) == -1) {
+            delete entry.pDoc;
+            return false;
+        }
+        pShared = entry.pDoc;
+        return true;
+    }
+
+    void share(JSONVar *pDoc) {
+        pShared = pDoc;
+        if (!pShared) {
+            return;
+        }
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        for (unsigned int i = 0; i < cache.length(); i++) {
+            if (cache[i].pDoc == pShared) {
+                ++cache[i].refs;
+                return;
+            }
+        }
     }
 
-    static void normalize(String &src) {
-        if (src.c_str()[0] == '/') {
-            src = src.substring(1);
+    void release() {
+        if (!pShared) {
+            return;
+        }
+        ustd::array<T_DOCCACHE> &cache = docCache();
+        for (unsigned int i = 0; i < cache.length(); i++) {
+            if (cache[i].pDoc == pShared) {
+                if (--cache[i].refs == 0 && cache[i].stale) {
+                    cachePurge(i);
+                }
+                break;
+            }
         }
+        pShared = nullptr;
     }
+#else
+    static void cacheInvalidate(String fn) {
+    }
+
+    void share(JSONVar *pDoc) {
+    }
+
+    void release() {
+    }
+#endif
 };
 
 }  // namespace ustd
\ No newline at end of file
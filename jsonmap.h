@@ -0,0 +1,697 @@
+// jsonmap.h - muwerk memory mapped read-only json files
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "jsonpath.h"
+#include "jsonbatch.h"
+
+#if defined(__UNIXOID__)
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef JSONFILE_MAP_DEPTH
+#define JSONFILE_MAP_DEPTH 64
+#endif
+
+namespace ustd {
+
+/*! \brief muwerk JSON View Class
+
+A jsonview is a reference to a value inside a \ref jsonmappedfile. It does
+not copy any data: strings and numbers are read from the memory mapping when
+they are accessed. A view is only valid as long as the file it was obtained
+from is open.
+*/
+class jsonview {
+  public:
+    //! \brief Types of JSON values
+    enum Type { UNDEFINED, OBJECT, ARRAY, STRING, NUMBER, BOOLEAN, NONE };
+
+    //! \brief Entry of the offset index of a \ref jsonmappedfile
+    typedef struct {
+        uint32_t start;     //!< offset of the value, for strings the first char after the quote
+        uint32_t len;       //!< length of the value text, for strings without the quotes
+        uint32_t skip;      //!< number of index entries of the value including its children
+        uint32_t children;  //!< number of elements of an array or members of an object
+        uint8_t type;       //!< \ref Type of the value
+    } T_NODE;
+
+  private:
+    const char *pData;
+    const T_NODE *pNodes;
+    uint32_t node;
+
+  public:
+    jsonview() : pData(nullptr), pNodes(nullptr), node(0) {
+        /*! Creates an undefined view */
+    }
+
+    jsonview(const char *pData, const T_NODE *pNodes, uint32_t node)
+        : pData(pData), pNodes(pNodes), node(node) {
+        /*! Creates a view of an entry of an offset index
+        @param pData Start of the mapped JSON text
+        @param pNodes Offset index of the JSON text
+        @param node Index of the entry
+        */
+    }
+
+    Type type() const {
+        /*! Get the type of the value
+        @return The \ref Type of the value, `UNDEFINED` for an invalid view
+        */
+        return pNodes ? (Type)pNodes[node].type : UNDEFINED;
+    }
+
+    String typeOf() const {
+        /*! Get the type of the value as string
+        @return The type in the notation of `JSON.typeof()`, e.g. `"number"`
+        */
+        static const char *names[] = {"undefined", "object", "array", "string",
+                                      "number",    "boolean", "null"};
+        return names[type()];
+    }
+
+    const char *data() const {
+        /*! Get the raw JSON text of the value
+        @return Pointer into the mapping. The text is not terminated, its length is \ref
+        length. For strings, this is the text between the quotes with escape sequences.
+        */
+        return pNodes ? pData + pNodes[node].start : "";
+    }
+
+    unsigned int length() const {
+        /*! Get the length of the raw JSON text of the value
+        @return Number of characters available at \ref data
+        */
+        return pNodes ? pNodes[node].len : 0;
+    }
+
+    unsigned int size() const {
+        /*! Get the number of elements of an array or members of an object
+        @return The number of elements or members, 0 for other types
+        */
+        return pNodes ? pNodes[node].children : 0;
+    }
+
+    jsonview operator[](unsigned int index) const {
+        /*! Get an element of an array or the value of a member of an object
+        @param index Index of the element or member
+        @return A view of the element, undefined if index is out of range
+        */
+        Type t = type();
+        if ((t != ARRAY && t != OBJECT) || index >= size()) {
+            return jsonview();
+        }
+        uint32_t i = node + 1;
+        while (true) {
+            if (t == OBJECT) {
+                ++i;  // member name
+            }
+            if (!index--) {
+                return jsonview(pData, pNodes, i);
+            }
+            i += pNodes[i].skip;
+        }
+    }
+
+    jsonview operator[](int index) const {
+        /*! Get an element of an array or the value of a member of an object
+        @param index Index of the element or member
+        @return A view of the element, undefined if index is out of range
+        */
+        return index < 0 ? jsonview() : (*this)[(unsigned int)index];
+    }
+
+    jsonview operator[](const char *key) const {
+        /*! Get the value of a member of an object
+        @param key Name of the member
+        @return A view of the value, undefined if the member does not exist
+        */
+        if (type() != OBJECT) {
+            return jsonview();
+        }
+        uint32_t i = node + 1;
+        for (uint32_t n = 0; n < size(); n++) {
+            if (jsonview(pData, pNodes, i) == key) {
+                return jsonview(pData, pNodes, i + 1);
+            }
+            i += 1 + pNodes[i + 1].skip;
+        }
+        return jsonview();
+    }
+
+    bool operator==(const char *str) const {
+        /*! Compare a string value without copying it
+        @param str Zero-terminated string to compare with
+        @return `true` if the value is a string and equal to str
+        */
+        if (type() != STRING) {
+            return false;
+        }
+        const char *p = data();
+        unsigned int len = length();
+        if (!memchr(p, '\\', len)) {
+            return !strncmp(p, str, len) && str[len] == 0;
+        }
+        return toString() == str;
+    }
+
+    String toString() const {
+        /*! Get the value as string
+        @return For strings the unescaped string, otherwise the raw JSON text of the value
+        */
+        String str = "";
+        str.reserve(length());
+        if (type() == STRING && memchr(data(), '\\', length())) {
+            unescapeTo(str);
+            return str;
+        }
+        appendTo(str);
+        return str;
+    }
+
+    double toDouble(double defaultVal = 0.0) const {
+        /*! Get the value as floating point number
+        @param defaultVal Value returned, if the value is not a number
+        @return The number or `defaultVal`
+        */
+        char buf[32];
+        if (type() != NUMBER || length() >= sizeof(buf)) {
+            return defaultVal;
+        }
+        // the mapping is not terminated
+        memcpy(buf, data(), length());
+        buf[length()] = 0;
+        return strtod(buf, nullptr);
+    }
+
+    long toLong(long defaultVal = 0) const {
+        /*! Get the value as integer
+        @param defaultVal Value returned, if the value is not a number
+        @return The number or `defaultVal`
+        */
+        return (long)toDouble((double)defaultVal);
+    }
+
+    bool toBool(bool defaultVal = false) const {
+        /*! Get the value as boolean
+        @param defaultVal Value returned, if the value is not a boolean
+        @return The boolean value or `defaultVal`
+        */
+        if (type() != BOOLEAN) {
+            return defaultVal;
+        }
+        return *data() == 't';
+    }
+
+  private:
+    void appendTo(String &str) const {
+        const char *p = data();
+        for (unsigned int i = 0; i < length(); i++) {
+            str += p[i];
+        }
+    }
+
+    void unescapeTo(String &str) const {
+        const char *p = data();
+        const char *end = p + length();
+        while (p < end) {
+            if (*p != '\\' || p + 1 == end) {
+                str += *p++;
+                continue;
+            }
+            ++p;
+            switch (*p) {
+            case 'b':
+                str += '\b';
+                break;
+            case 'f':
+                str += '\f';
+                break;
+            case 'n':
+                str += '\n';
+                break;
+            case 'r':
+                str += '\r';
+                break;
+            case 't':
+                str += '\t';
+                break;
+            case 'u': {
+                long cp = end - p > 4 ? hexValue(p + 1) : -1;
+                if (cp < 0) {
+                    // invalid escape, keep it
+                    str += '\\';
+                    str += 'u';
+                    break;
+                }
+                p += 4;
+                if (cp >= 0xd800 && cp < 0xdc00 && end - p > 6 && p[1] == '\\' && p[2] == 'u') {
+                    long lo = hexValue(p + 3);
+                    if (lo >= 0xdc00 && lo <= 0xdfff) {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                        p += 6;
+                    }
+                }
+                if (cp >= 0xd800 && cp <= 0xdfff) {
+                    // unpaired surrogate
+                    cp = 0xfffd;
+                }
+                appendUtf8(str, (unsigned long)cp);
+                break;
+            }
+            default:
+                // \", \\ and \/
+                str += *p;
+                break;
+            }
+            ++p;
+        }
+    }
+
+    static long hexValue(const char *p) {
+        long v = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = p[i];
+            if (c >= '0' && c <= '9') {
+                v = v * 16 + c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                v = v * 16 + c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                v = v * 16 + c - 'A' + 10;
+            } else {
+                return -1;
+            }
+        }
+        return v;
+    }
+
+    static void appendUtf8(String &str, unsigned long cp) {
+        if (cp < 0x80) {
+            str += (char)cp;
+        } else if (cp < 0x800) {
+            str += (char)(0xc0 | (cp >> 6));
+            str += (char)(0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            str += (char)(0xe0 | (cp >> 12));
+            str += (char)(0x80 | ((cp >> 6) & 0x3f));
+            str += (char)(0x80 | (cp & 0x3f));
+        } else {
+            str += (char)(0xf0 | (cp >> 18));
+            str += (char)(0x80 | ((cp >> 12) & 0x3f));
+            str += (char)(0x80 | ((cp >> 6) & 0x3f));
+            str += (char)(0x80 | (cp & 0x3f));
+        }
+    }
+};
+
+/*! \brief muwerk JSON Mapped File Class
+
+Read-only access to large JSON files on Linux. The file is mapped into memory
+and parsed in situ into a compact offset index with one \ref
+jsonview::T_NODE entry (20 bytes) per value, no strings are copied and no
+JSONVar tree is built. Lookups return \ref jsonview objects that refer to the
+mapping, so loading a large configuration costs little more than reading its
+pages.
+
+Keys are paths within the document, elements of arrays can be addressed by
+their index:
+
+~~~{.cpp}
+    ustd::jsonmappedfile cfg;
+    if (cfg.open("/etc/gateway/devices.json")) {
+        String host = cfg.readString("net/hostname", "localhost");
+        long port = cfg.readLong("devices/0/port", 502);
+        ustd::jsonview devices = cfg.find("devices");
+        for (unsigned int i = 0; i < devices.size(); i++) {
+            String name = devices[i]["name"].toString();
+        }
+    }
+~~~
+
+Views obtained from a file become invalid when the file is closed.
+*/
+class jsonmappedfile {
+  private:
+    int fd = -1;
+    const char *pData = nullptr;
+    size_t dataSize = 0;
+    jsonview::T_NODE *pNodes = nullptr;
+    uint32_t nodeCount = 0;
+    uint32_t nodeMax = 0;
+
+  public:
+    jsonmappedfile() {
+        /*! Creates a mapped file, use \ref open to map a file */
+    }
+
+    jsonmappedfile(const jsonmappedfile &) = delete;
+    jsonmappedfile &operator=(const jsonmappedfile &) = delete;
+
+    ~jsonmappedfile() {
+        close();
+    }
+
+    bool open(String filename) {
+        /*! Map and index a JSON file
+        @param filename Path of the file in the file system
+        @return `true` on success, `false` if the file cannot be mapped or is not valid JSON.
+        */
+        close();
+        fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            DBG("Cannot open " + filename);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) || !st.st_size || (uint64_t)st.st_size >= 0xffffffff) {
+            DBG("Cannot map " + filename + ", empty or too large");
+            close();
+            return false;
+        }
+        void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            DBG("Cannot map " + filename);
+            close();
+            return false;
+        }
+        pData = (const char *)p;
+        dataSize = st.st_size;
+        // the index is built front to back
+        madvise(p, dataSize, MADV_SEQUENTIAL);
+        const char *pc = pData;
+        if (!parseValue(pc, 0) || skipSpace(pc) != pData + dataSize) {
+            DBG("Parsing input file " + filename + " failed, invalid JSON!");
+            close();
+            return false;
+        }
+        madvise(p, dataSize, MADV_NORMAL);
+        DBG2("Input file " + filename + " mapped");
+        return true;
+    }
+
+    void close() {
+        /*! Unmap the file and free the index. All views of the file become invalid. */
+        if (pData) {
+            munmap((void *)pData, dataSize);
+            pData = nullptr;
+            dataSize = 0;
+        }
+        if (fd != -1) {
+            ::close(fd);
+            fd = -1;
+        }
+        if (pNodes) {
+            free(pNodes);
+            pNodes = nullptr;
+        }
+        nodeCount = nodeMax = 0;
+    }
+
+    bool isOpen() const {
+        /*! Check if a file is mapped
+        @return `true` if a valid JSON file is mapped
+        */
+        return pData != nullptr;
+    }
+
+    jsonview root() const {
+        /*! Get the top level value of the document
+        @return A view of the document, undefined if no file is mapped
+        */
+        return isOpen() ? jsonview(pData, pNodes, 0) : jsonview();
+    }
+
+    jsonview find(const jsonpath &key) const {
+        /*! Find a value by its key path
+        @param key Key path within the document, segments that consist of digits address
+                   elements of arrays. Like in \ref jsonfile, empty segments address members
+                   with an empty name.
+        @return A view of the value, undefined if it does not exist
+        */
+        jsonview value = root();
+        for (unsigned int i = 0; i < key.length() && value.type() != jsonview::UNDEFINED; i++) {
+            value = child(value, key[i]);
+        }
+        return value;
+    }
+
+    unsigned int readBatch(jsonbatch &batch) const {
+        /*! Read all values of a batch of keys.
+        The document is traversed once, keys with a common prefix share the lookup of
+        their common parent values.
+        @param batch The keys with their target variables, see \ref jsonbatch. The keys are
+                     paths within the document.
+        @return Number of values found, values not found receive their default value.
+        */
+        return readMembers(root(), batch, 0, batch.length(), 0);
+    }
+
+    bool exists(const jsonpath &key) const {
+        /*! Check if a value exists
+        @param key Key path within the document
+        @return `true` if the value exists.
+        */
+        return find(key).type() != jsonview::UNDEFINED;
+    }
+
+    String readString(const jsonpath &key, String defaultVal) const {
+        /*! Read a string value
+        @param key Key path within the document
+        @param defaultVal value returned, if key is not found or not a string.
+        @return The requested value or `defaultVal`
+        */
+        jsonview value = find(key);
+        return value.type() == jsonview::STRING ? value.toString() : defaultVal;
+    }
+
+    double readDouble(const jsonpath &key, double defaultVal) const {
+        /*! Read a numeric value
+        @param key Key path within the document
+        @param defaultVal value returned, if key is not found or not a number.
+        @return The requested value or `defaultVal`
+        */
+        return find(key).toDouble(defaultVal);
+    }
+
+    long readLong(const jsonpath &key, long defaultVal) const {
+        /*! Read an integer value
+        @param key Key path within the document
+        @param defaultVal value returned, if key is not found or not a number.
+        @return The requested value or `defaultVal`
+        */
+        return find(key).toLong(defaultVal);
+    }
+
+    bool readBool(const jsonpath &key, bool defaultVal) const {
+        /*! Read a boolean value
+        @param key Key path within the document
+        @param defaultVal value returned, if key is not found or not a boolean.
+        @return The requested value or `defaultVal`
+        */
+        return find(key).toBool(defaultVal);
+    }
+
+  private:
+    static jsonview child(const jsonview &node, const char *seg) {
+        // segments that consist of digits address elements of arrays
+        if (node.type() == jsonview::ARRAY && *seg >= '0' && *seg <= '9') {
+            return node[(unsigned int)strtoul(seg, nullptr, 10)];
+        }
+        return node[seg];
+    }
+
+    static unsigned int readMembers(const jsonview &node, jsonbatch &batch, unsigned int first,
+                                    unsigned int last, unsigned int level) {
+        // all keys in [first, last) share the segments below level
+        unsigned int found = 0;
+        while (first < last) {
+            const jsonpath &key = batch.entries[first]->key;
+            unsigned int end = batch.groupEnd(first, last, level);
+            jsonview value = child(node, key[level]);
+            if (value.type() == jsonview::UNDEFINED) {
+                DBG2("From " + key.toString() + ", element " + key[level] + " not found.");
+                batch.assignDefault(first, end);
+                first = end;
+                continue;
+            }
+            for (; first < end && batch.entries[first]->key.length() == level + 1; first++) {
+                found += assignBatch(batch, first, value) ? 1 : 0;
+            }
+            if (first < end) {
+                found += readMembers(value, batch, first, end, level + 1);
+            }
+            first = end;
+        }
+        return found;
+    }
+
+    static bool assignBatch(jsonbatch &batch, unsigned int index, const jsonview &value) {
+        switch (value.type()) {
+        case jsonview::STRING:
+            return batch.assign(index, value.typeOf(), value.toString().c_str(), 0.0);
+        case jsonview::BOOLEAN:
+            return batch.assign(index, value.typeOf(), "", value.toBool() ? 1.0 : 0.0);
+        default:
+            return batch.assign(index, value.typeOf(), "", value.toDouble());
+        }
+    }
+
+    const char *skipSpace(const char *p) const {
+        const char *end = pData + dataSize;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+        return p;
+    }
+
+    bool addNode(const char *p, uint8_t type, uint32_t &node) {
+        if (nodeCount == nodeMax) {
+            uint32_t newMax = nodeMax ? nodeMax * 2 : 256;
+            jsonview::T_NODE *pNew =
+                (jsonview::T_NODE *)realloc(pNodes, newMax * sizeof(jsonview::T_NODE));
+            if (!pNew) {
+                DBG("jsonmappedfile: failed to allocate index");
+                return false;
+            }
+            pNodes = pNew;
+            nodeMax = newMax;
+        }
+        node = nodeCount++;
+        pNodes[node].start = (uint32_t)(p - pData);
+        pNodes[node].len = 0;
+        pNodes[node].skip = 1;
+        pNodes[node].children = 0;
+        pNodes[node].type = type;
+        return true;
+    }
+
+    bool parseString(const char *&p) {
+        const char *end = pData + dataSize;
+        uint32_t node;
+        if (!addNode(p + 1, jsonview::STRING, node)) {
+            return false;
+        }
+        for (++p; p < end && *p != '"'; ++p) {
+            if (*p == '\\') {
+                ++p;
+            }
+        }
+        if (p >= end) {
+            return false;
+        }
+        pNodes[node].len = (uint32_t)(p - pData) - pNodes[node].start;
+        ++p;
+        return true;
+    }
+
+    bool parseLiteral(const char *&p, const char *literal, uint8_t type) {
+        size_t len = strlen(literal);
+        uint32_t node;
+        if ((size_t)(pData + dataSize - p) < len || strncmp(p, literal, len) ||
+            !addNode(p, type, node)) {
+            return false;
+        }
+        pNodes[node].len = len;
+        p += len;
+        return true;
+    }
+
+    bool parseNumber(const char *&p) {
+        const char *end = pData + dataSize;
+        const char *start = p;
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' ||
+                           *p == 'e' || *p == 'E')) {
+            ++p;
+        }
+        uint32_t node;
+        if (p == start || !addNode(start, jsonview::NUMBER, node)) {
+            return false;
+        }
+        pNodes[node].len = (uint32_t)(p - start);
+        return true;
+    }
+
+    bool parseValue(const char *&p, unsigned int depth) {
+        p = skipSpace(p);
+        if (p == pData + dataSize) {
+            return false;
+        }
+        switch (*p) {
+        case '{':
+        case '[':
+            return depth < JSONFILE_MAP_DEPTH && parseContainer(p, depth);
+        case '"':
+            return parseString(p);
+        case 't':
+            return parseLiteral(p, "true", jsonview::BOOLEAN);
+        case 'f':
+            return parseLiteral(p, "false", jsonview::BOOLEAN);
+        case 'n':
+            return parseLiteral(p, "null", jsonview::NONE);
+        default:
+            return parseNumber(p);
+        }
+    }
+
+    bool parseContainer(const char *&p, unsigned int depth) {
+        const char *end = pData + dataSize;
+        bool isObject = *p == '{';
+        char close = isObject ? '}' : ']';
+        uint32_t node;
+        if (!addNode(p, isObject ? jsonview::OBJECT : jsonview::ARRAY, node)) {
+            return false;
+        }
+        // entries may be reallocated while parsing the children, so access them by index
+        uint32_t children = 0;
+        p = skipSpace(p + 1);
+        if (p < end && *p == close) {
+            ++p;
+        } else {
+            while (true) {
+                if (isObject) {
+                    p = skipSpace(p);
+                    if (p == end || *p != '"' || !parseString(p)) {
+                        return false;
+                    }
+                    p = skipSpace(p);
+                    if (p == end || *p != ':') {
+                        return false;
+                    }
+                    ++p;
+                }
+                if (!parseValue(p, depth + 1)) {
+                    return false;
+                }
+                ++children;
+                p = skipSpace(p);
+                if (p == end) {
+                    return false;
+                }
+                if (*p == close) {
+                    ++p;
+                    break;
+                }
+                if (*p != ',') {
+                    return false;
+                }
+                ++p;
+            }
+        }
+        pNodes[node].len = (uint32_t)(p - pData) - pNodes[node].start;
+        pNodes[node].skip = nodeCount - node;
+        pNodes[node].children = children;
+        return true;
+    }
+};
+
+}  // namespace ustd
+
+#endif  // __UNIXOID__
@@ -0,0 +1,192 @@
+// jsonpath.h - muwerk precompiled json key paths
+
+#pragma once
+
+#include "ustd_platform.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ustd {
+
+/*! \brief muwerk JSON Path Class
+
+A jsonpath is a precompiled key of a \ref jsonfile: the key is normalized and
+split into its segments once, all segments are stored contiguously in a
+single allocated block together with a hash of each segment. The hashes let
+\ref jsonstreamreader and \ref jsonbatch reject non-matching member names
+without a string compare. All read and write functions of \ref jsonfile and
+\ref jsonmappedfile accept a jsonpath in place of the key, so that keys used on
+a hot path can be compiled once and then used without further allocations.
+
+~~~{.cpp}
+    ustd::jsonpath ssidKey("net/station/ssid");
+    ustd::jsonfile jf;
+    String ssid = jf.readString(ssidKey, "");
+~~~
+*/
+class jsonpath {
+  private:
+    uint32_t *pHashes = nullptr;
+    uint16_t *pOffsets = nullptr;
+    char *pChars = nullptr;
+    unsigned int count = 0;
+    size_t size = 0;
+
+  public:
+    jsonpath() {
+        /*! Creates an empty jsonpath */
+    }
+
+    jsonpath(const char *key) {
+        /*! Compiles a jsonpath from a key
+        @param key Combined filename and json-object-path, e.g. `net/station/ssid`
+        */
+        compile(key);
+    }
+
+    jsonpath(const String &key) {
+        /*! Compiles a jsonpath from a key
+        @param key Combined filename and json-object-path, e.g. `net/station/ssid`
+        */
+        compile(key.c_str());
+    }
+
+#ifndef __UNIXOID__
+    jsonpath(const __FlashStringHelper *key) {
+        /*! Compiles a jsonpath from a key stored in flash memory
+        @param key Combined filename and json-object-path, e.g. `F("net/station/ssid")`
+        */
+        compile(String(key).c_str());
+    }
+#endif
+
+    jsonpath(const jsonpath &src) {
+        /*! Creates a copy of a jsonpath
+        @param src Source jsonpath
+        */
+        copy(src);
+    }
+
+    ~jsonpath() {
+        free(pHashes);
+    }
+
+    jsonpath &operator=(const jsonpath &src) {
+        /*! Assigns another jsonpath
+        @param src Source jsonpath
+        */
+        if (this != &src) {
+            free(pHashes);
+            copy(src);
+        }
+        return *this;
+    }
+
+    unsigned int length() const {
+        /*! Number of segments of the path, including the filename
+        @return Number of segments
+        */
+        return count;
+    }
+
+    const char *operator[](unsigned int index) const {
+        /*! Get a segment of the path
+        @param index Index of the segment, 0 is the filename
+        @return The segment or an empty string, if the index is out of range
+        */
+        return index < count ? pChars + pOffsets[index] : "";
+    }
+
+    uint32_t hash(unsigned int index) const {
+        /*! Get the hash of a segment of the path
+        @param index Index of the segment, 0 is the filename
+        @return The FNV-1a hash of the segment or 0, if the index is out of range
+        */
+        return index < count ? pHashes[index] : 0;
+    }
+
+    String toString(unsigned int first = 0) const {
+        /*! Get the path as key string
+        @param first (optional, default is 0) Index of the first segment to include
+        @return The segments starting from `first`, separated by `/`
+        */
+        String key = "";
+        for (unsigned int i = first; i < count; i++) {
+            if (i > first) {
+                key += "/";
+            }
+            key += (*this)[i];
+        }
+        return key;
+    }
+
+    static uint32_t hashOf(const char *segment) {
+        /*! Calculate the hash of a segment
+        @param segment Segment of a key path
+        @return FNV-1a hash of the segment
+        */
+        uint32_t h = 2166136261UL;
+        while (*segment) {
+            h = (h ^ (uint8_t)*segment++) * 16777619UL;
+        }
+        return h;
+    }
+
+  private:
+    void compile(const char *key) {
+        if (*key == '/') {
+            ++key;
+        }
+        size_t len = strlen(key);
+        unsigned int segments = 1;
+        for (size_t i = 0; i < len; i++) {
+            if (key[i] == '/') {
+                ++segments;
+            }
+        }
+        // hashes, offsets and the segments in one block
+        size = segments * (sizeof(uint32_t) + sizeof(uint16_t)) + len + 1;
+        if (!alloc(segments)) {
+            return;
+        }
+        memcpy(pChars, key, len + 1);
+        unsigned int seg = 0;
+        pOffsets[0] = 0;
+        for (size_t i = 0; i < len; i++) {
+            if (pChars[i] == '/') {
+                pChars[i] = 0;
+                pOffsets[++seg] = (uint16_t)(i + 1);
+            }
+        }
+        for (unsigned int i = 0; i < count; i++) {
+            pHashes[i] = hashOf(pChars + pOffsets[i]);
+        }
+    }
+
+    void copy(const jsonpath &src) {
+        size = src.size;
+        if (!src.count || !alloc(src.count)) {
+            pHashes = nullptr;
+            count = 0;
+            return;
+        }
+        memcpy(pHashes, src.pHashes, size);
+    }
+
+    bool alloc(unsigned int segments) {
+        pHashes = (uint32_t *)malloc(size);
+        if (!pHashes) {
+            DBG("jsonpath: failed to allocate key path");
+            count = 0;
+            return false;
+        }
+        count = segments;
+        pOffsets = (uint16_t *)(pHashes + count);
+        pChars = (char *)(pOffsets + count);
+        return true;
+    }
+};
+
+}  // namespace ustd
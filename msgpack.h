@@ -0,0 +1,438 @@
+// msgpack.h - muwerk MessagePack encoder and decoder
+
+#pragma once
+
+#include "ustd_platform.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace ustd {
+
+/*! \brief muwerk MessagePack Encoder Class
+
+Writes values in the binary MessagePack format (https://msgpack.org) to a
+stream. The encoder has no notion of a document: containers are written as a
+header with the number of elements, followed by the elements (for maps: key
+and value alternating). The output is buffered in chunks of CHUNK bytes.
+
+T_STREAM can be any class with a member `size_t write(const uint8_t *, size_t)`,
+e.g. `fs::File`. Integers are written in the smallest possible representation,
+doubles as 32 bit float, if that is exact.
+
+~~~{.cpp}
+    fs::File f = ustd::fsOpen("/data.msgpack", "w");
+    ustd::msgpackEncoder<fs::File> enc(f);
+    enc.writeMap(2);
+    enc.writeString("temperature");
+    enc.writeDouble(21.5);
+    enc.writeString("count");
+    enc.writeInt(1234);
+    bool ok = enc.flush();
+    f.close();
+~~~
+*/
+template <typename T_STREAM, unsigned int CHUNK = 64> class msgpackEncoder {
+  private:
+    T_STREAM &stream;
+    uint8_t buf[CHUNK];
+    unsigned int len = 0;
+    bool failed = false;
+
+  public:
+    msgpackEncoder(T_STREAM &stream) : stream(stream) {
+        /*! Creates an encoder for a stream
+        @param stream Stream opened for writing
+        */
+    }
+
+    void writeNil() {
+        /*! Write a nil (JSON null) value */
+        put(0xc0);
+    }
+
+    void writeBool(bool value) {
+        /*! Write a boolean value
+        @param value The value
+        */
+        put(value ? 0xc3 : 0xc2);
+    }
+
+    void writeInt(long long value) {
+        /*! Write an integer value
+        @param value The value
+        */
+        if (value >= 0) {
+            if (value < 0x80) {
+                put((uint8_t)value);
+            } else if (value < 0x100) {
+                put(0xcc);
+                put((uint8_t)value);
+            } else if (value < 0x10000) {
+                put(0xcd);
+                putBE(value, 2);
+            } else if (value < 0x100000000LL) {
+                put(0xce);
+                putBE(value, 4);
+            } else {
+                put(0xcf);
+                putBE(value, 8);
+            }
+        } else if (value >= -32) {
+            put((uint8_t)(int8_t)value);
+        } else if (value >= -0x80) {
+            put(0xd0);
+            put((uint8_t)(int8_t)value);
+        } else if (value >= -0x8000) {
+            put(0xd1);
+            putBE((uint16_t)(int16_t)value, 2);
+        } else if (value >= -0x80000000LL) {
+            put(0xd2);
+            putBE((uint32_t)(int32_t)value, 4);
+        } else {
+            put(0xd3);
+            putBE((uint64_t)value, 8);
+        }
+    }
+
+    void writeDouble(double value) {
+        /*! Write a floating point value
+        @param value The value, stored as 32 bit float if that is exact
+        */
+        float fl = (float)value;
+        if (sizeof(double) < sizeof(uint64_t) || (double)fl == value) {
+            uint32_t bits;
+            memcpy(&bits, &fl, sizeof(bits));
+            put(0xca);
+            putBE(bits, 4);
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(value));
+            put(0xcb);
+            putBE(bits, 8);
+        }
+    }
+
+    void writeString(const char *str, unsigned long length) {
+        /*! Write a string
+        @param str UTF-8 encoded string
+        @param length Number of bytes of the string
+        */
+        putHeader(0xa0, 32, 0xda, length);
+        for (unsigned long i = 0; i < length; i++) {
+            put((uint8_t)str[i]);
+        }
+    }
+
+    void writeString(const char *str) {
+        /*! Write a zero terminated string
+        @param str UTF-8 encoded string
+        */
+        writeString(str, strlen(str));
+    }
+
+    void writeArray(unsigned long count) {
+        /*! Write the header of an array
+        @param count Number of elements that follow
+        */
+        putHeader(0x90, 16, 0xdc, count);
+    }
+
+    void writeMap(unsigned long count) {
+        /*! Write the header of a map
+        @param count Number of key/value pairs that follow
+        */
+        putHeader(0x80, 16, 0xde, count);
+    }
+
+    bool flush() {
+        /*! Write the buffered data to the stream
+        @return `true`, if all data has been written successfully.
+        */
+        if (len && stream.write(buf, len) != len) {
+            failed = true;
+        }
+        len = 0;
+        return !failed;
+    }
+
+  private:
+    void put(uint8_t b) {
+        if (len == sizeof(buf)) {
+            flush();
+        }
+        buf[len++] = b;
+    }
+
+    void putBE(uint64_t v, unsigned int bytes) {
+        while (bytes--) {
+            put((uint8_t)(v >> (8 * bytes)));
+        }
+    }
+
+    void putHeader(uint8_t fix, unsigned int fixMax, uint8_t code, unsigned long n) {
+        // fix/16/32 bit variants of map, array and str headers
+        if (n < fixMax) {
+            put(fix | n);
+        } else if (fixMax == 32 && n < 0x100) {
+            put(0xd9);
+            put(n);
+        } else if (n < 0x10000) {
+            put(code);
+            putBE(n, 2);
+        } else {
+            put(code + 1);
+            putBE(n, 4);
+        }
+    }
+};
+
+/*! \brief muwerk MessagePack Decoder Class
+
+Reads values in the binary MessagePack format from a stream, item by item:
+\ref read returns the type of the next item and makes its value available.
+For strings, arrays and maps only the header is read: the bytes of a string
+are read with \ref readString, the elements of containers with further calls
+to \ref read. The input is read in chunks of CHUNK bytes.
+
+T_STREAM can be any class with a member `size_t read(uint8_t *, size_t)`, e.g.
+`fs::File`. Binary and extension types are not supported. Unsigned integers
+that do not fit into a `long long` are returned as \ref FLOAT.
+
+~~~{.cpp}
+    fs::File f = ustd::fsOpen("/data.msgpack", "r");
+    ustd::msgpackDecoder<fs::File> dec(f);
+    if (dec.read() == dec.MAP) {
+        for (unsigned long i = dec.length(); i; i--) {
+            String key;
+            if (dec.read() != dec.STRING || !dec.readString(key)) {
+                break;
+            }
+            switch (dec.read()) {
+            case dec.INTEGER:
+                // dec.integer()
+                break;
+            ...
+            }
+        }
+    }
+    f.close();
+~~~
+*/
+template <typename T_STREAM, unsigned int CHUNK = 64> class msgpackDecoder {
+  public:
+    enum Type { INVALID, NIL, BOOLEAN, INTEGER, FLOAT, STRING, ARRAY, MAP };
+
+  private:
+    T_STREAM &stream;
+    uint8_t buf[CHUNK];
+    unsigned int len = 0;
+    unsigned int pos = 0;
+    bool failed = false;
+    long long intValue = 0;
+    double floatValue = 0.0;
+    unsigned long count = 0;
+
+  public:
+    msgpackDecoder(T_STREAM &stream) : stream(stream) {
+        /*! Creates a decoder for a stream
+        @param stream Stream opened for reading, positioned at the start of an item
+        */
+    }
+
+    Type read() {
+        /*! Read the next item
+        @return The type of the item. \ref INVALID at the end of the stream, on
+        truncated data or if the item has an unsupported type.
+        */
+        int c = get();
+        if (c == -1) {
+            return INVALID;
+        }
+        if (c < 0x80) {
+            intValue = c;
+            return INTEGER;
+        }
+        if (c >= 0xe0) {
+            intValue = (int8_t)c;
+            return INTEGER;
+        }
+        if (c < 0x90) {
+            count = c & 0x0f;
+            return MAP;
+        }
+        if (c < 0xa0) {
+            count = c & 0x0f;
+            return ARRAY;
+        }
+        if (c < 0xc0) {
+            count = c & 0x1f;
+            return STRING;
+        }
+        switch (c) {
+        case 0xc0:
+            return NIL;
+        case 0xc2:
+        case 0xc3:
+            intValue = c == 0xc3;
+            return BOOLEAN;
+        case 0xca: {
+            uint32_t bits = getBE(4);
+            float fl;
+            memcpy(&fl, &bits, sizeof(fl));
+            floatValue = fl;
+            return checked(FLOAT);
+        }
+        case 0xcb: {
+            uint64_t bits = getBE(8);
+            if (sizeof(double) == sizeof(bits)) {
+                memcpy(&floatValue, &bits, sizeof(floatValue));
+            } else {
+                floatValue = narrowDouble(bits);
+            }
+            return checked(FLOAT);
+        }
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+            intValue = getBE(1 << (c - 0xcc));
+            return checked(INTEGER);
+        case 0xcf: {
+            uint64_t v = getBE(8);
+            if (v > 0x7fffffffffffffffULL) {
+                floatValue = (double)v;
+                return checked(FLOAT);
+            }
+            intValue = v;
+            return checked(INTEGER);
+        }
+        case 0xd0:
+            intValue = (int8_t)getBE(1);
+            return checked(INTEGER);
+        case 0xd1:
+            intValue = (int16_t)getBE(2);
+            return checked(INTEGER);
+        case 0xd2:
+            intValue = (int32_t)getBE(4);
+            return checked(INTEGER);
+        case 0xd3:
+            intValue = (int64_t)getBE(8);
+            return checked(INTEGER);
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            count = getBE(1 << (c - 0xd9));
+            return checked(STRING);
+        case 0xdc:
+        case 0xdd:
+            count = getBE(c == 0xdc ? 2 : 4);
+            return checked(ARRAY);
+        case 0xde:
+        case 0xdf:
+            count = getBE(c == 0xde ? 2 : 4);
+            return checked(MAP);
+        default:
+            // binary and extension types are not supported
+            failed = true;
+            return INVALID;
+        }
+    }
+
+    bool boolean() const {
+        /*! Value of a \ref BOOLEAN item
+        @return The value
+        */
+        return intValue != 0;
+    }
+
+    long long integer() const {
+        /*! Value of an \ref INTEGER item
+        @return The value
+        */
+        return intValue;
+    }
+
+    double number() const {
+        /*! Value of a \ref FLOAT item
+        @return The value
+        */
+        return floatValue;
+    }
+
+    unsigned long length() const {
+        /*! Size of a \ref STRING, \ref ARRAY or \ref MAP item
+        @return Number of bytes of a string, number of elements of an array or number of
+        key/value pairs of a map
+        */
+        return count;
+    }
+
+    bool readString(String &value) {
+        /*! Read the bytes of a \ref STRING item
+        @param value Receives the string
+        @return `true` on success, `false` if the data is truncated.
+        */
+        value = "";
+        if (count <= 1024) {
+            // a corrupted length must not allocate unbounded memory in advance
+            value.reserve(count);
+        }
+        for (unsigned long i = 0; i < count; i++) {
+            int c = get();
+            if (c == -1) {
+                return false;
+            }
+            value += (char)c;
+        }
+        return true;
+    }
+
+    bool ok() const {
+        /*! Check the state of the decoder
+        @return `false`, if truncated or unsupported data has been read.
+        */
+        return !failed;
+    }
+
+  private:
+    int get() {
+        if (pos == len) {
+            len = stream.read(buf, sizeof(buf));
+            pos = 0;
+            if (!len) {
+                failed = true;
+                return -1;
+            }
+        }
+        return buf[pos++];
+    }
+
+    uint64_t getBE(unsigned int bytes) {
+        uint64_t v = 0;
+        while (bytes--) {
+            v = (v << 8) | (uint8_t)get();
+        }
+        return v;
+    }
+
+    static float narrowDouble(uint64_t bits) {
+        // platforms with 32 bit double (AVR): truncate exponent and mantissa to float
+        int exp = (int)((bits >> 52) & 0x7ff) - 1023 + 127;
+        uint32_t fbits = (uint32_t)(bits >> 32) & 0x80000000UL;
+        if (exp >= 0xff) {
+            fbits |= 0x7f800000UL;
+        } else if (exp > 0) {
+            fbits |= ((uint32_t)exp << 23) | ((uint32_t)(bits >> 29) & 0x7fffffUL);
+        }
+        float fl;
+        memcpy(&fl, &fbits, sizeof(fl));
+        return fl;
+    }
+
+    Type checked(Type type) const {
+        // payload of the header may be truncated
+        return failed ? INVALID : type;
+    }
+};
+
+}  // namespace ustd
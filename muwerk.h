@@ -8,9 +8,23 @@
 muwerk implements the following classes:
 
 * * \ref ustd::jsonfile A utility class for easily managing data stored in JSON files
+* * \ref ustd::jsonpath Precompiled key paths for \ref ustd::jsonfile and \ref ustd::jsonmappedfile
+* * \ref ustd::jsonbatch Batches of keys that are read in a single traversal of the documents
+* * \ref ustd::jsonmappedfile and \ref ustd::jsonview Read-only access to memory mapped JSON files on Linux
+* * \ref ustd::msgpackEncoder and \ref ustd::msgpackDecoder Streaming MessagePack encoder and decoder
 * * \ref ustd::heartbeat A utility class for handling periodical operations at fixed intervals
 * * \ref ustd::Scheduler A cooperative scheduler and MQTT-like queues
 * * \ref ustd::sensorprocessor An exponential sensor value filter
+* * \ref ustd::fixedsensorprocessor A fixed-point exponential sensor value filter for FPU-less MCUs
+* * \ref ustd::sensorbank A multi-channel exponential sensor value filter
+* * \ref ustd::sensorfilter A sensor value filter with pluggable filter engines (moving average, median, Kalman)
+* * \ref ustd::numericFunction, \ref ustd::constNumericFunction and \ref ustd::numericFunctionView Approximation of functions defined by points
+* * \ref ustd::SensorPipeline A scheduler task that reads, filters, calibrates and publishes sensor values
+* * \ref ustd::SensorHistory A downsampled on-device history of sensor values with min/max/avg buckets
+* * \ref ustd::TimeSeriesStore A compressed (delta-of-delta / XOR) time series store on the flash filesystem
+* * \ref ustd::ThresholdDetector A threshold detector with hysteresis and dwell time that publishes edge events
+* * \ref ustd::cicDecimator and \ref ustd::firDecimator Fixed-point decimation filters for high-rate acquisition
+* * \ref ustd::SpectrumAnalyzer, \ref ustd::realFFT and \ref ustd::goertzel Incremental spectral feature extraction
 * * \ref ustd::SerialConsole A serial debug console for the scheduler
 * * \ref ustd::timeout and \ref ustd::utimeout Utility classes for handling timeouts
 
@@ -0,0 +1,333 @@
+// sensorhistory.h - muwerk downsampled on-device sensor history
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "scheduler.h"
+
+#include <stdint.h>
+
+namespace ustd {
+
+/*! \brief muwerk SensorHistory Class
+
+The SensorHistory class keeps a compact, multi-resolution history of a sensor value in RAM,
+e.g. to serve dashboards while no MQTT connection is available. It maintains three fixed
+size rings:
+
+* `raw`: the last RAW_N values as ingested,
+* `minute`: the last MINUTE_N per-minute buckets with min, max and average,
+* `hour`: the last HOUR_N per-hour buckets with min, max and average.
+
+All storage is allocated statically by the template parameters, insertion is O(1): the
+current minute and hour buckets are accumulated incrementally and are pushed into their
+rings when their time slot is complete. With the default parameters (60 raw values, 60
+minutes, 24 hours with float values) a history needs about 2 KB of RAM.
+
+Timestamps are in seconds. If no timestamp is given, the seconds since startup (derived from
+`millis()`) are used. Applications with a valid real-time clock should pass the unix time.
+
+Values can be ingested directly with \ref add or by attaching the history to a topic (e.g.
+the output of a \ref ustd::SensorPipeline) with \ref begin.
+
+The following messages are supported:
+
+* publish: `name/history/get` with message `<resolution>[,<from>[,<to>]]` (`resolution` is
+  one of `raw`, `minute` or `hour`, `from` and `to` are optional timestamps in seconds) ->
+  `name/history/<resolution>` with a json object:
+  `{"resolution":"minute","data":[[t,min,max,avg],...]}`. The data is sorted from oldest to
+  newest, `raw` entries are `[t,value]`.
+
+## Sample recording the output of a sensor pipeline:
+
+~~~{.cpp}
+#include <scheduler.h>
+#include <sensorpipeline.h>
+#include <sensorhistory.h>
+
+ustd::Scheduler sched(10, 16, 32);
+
+ustd::SensorPipeline<> temperature("temperature", readTemperature);
+ustd::SensorHistory<> temperatureHistory("temperature");
+
+void setup() {
+    temperature.begin(&sched, 500000L);
+    temperatureHistory.begin(&sched, "temperature/value");
+}
+~~~
+
+*/
+template <unsigned int RAW_N = 60, unsigned int MINUTE_N = 60, unsigned int HOUR_N = 24,
+          typename T_FLOAT = float>
+class SensorHistory {
+  public:
+    //! \brief Resolution levels of the history
+    enum Resolution { RAW = 0, MINUTE = 1, HOUR = 2 };
+
+    //! \brief A downsampled bucket of the history
+    struct Bucket {
+        uint32_t t;       //!< start time of the bucket in seconds
+        T_FLOAT minVal;   //!< minimum value in the bucket
+        T_FLOAT maxVal;   //!< maximum value in the bucket
+        T_FLOAT sum;      //!< sum of all values in the bucket
+        uint32_t count;   //!< number of values in the bucket
+
+        T_FLOAT avg() const {
+            //! Returns the average value of the bucket
+            return count ? sum / count : 0;
+        }
+    };
+
+    String name;
+
+  private:
+    // muwerk task management
+    Scheduler *pSched = nullptr;
+
+    // raw ring
+    uint32_t rawTime[RAW_N];
+    T_FLOAT rawVal[RAW_N];
+    unsigned int rawHead = 0;
+    unsigned int rawCount = 0;
+
+    // downsampled rings
+    Bucket minutes[MINUTE_N];
+    unsigned int minuteHead = 0;
+    unsigned int minuteCount = 0;
+    Bucket hours[HOUR_N];
+    unsigned int hourHead = 0;
+    unsigned int hourCount = 0;
+
+    // buckets under construction
+    Bucket curMinute;
+    Bucket curHour;
+
+  public:
+    SensorHistory(String name) : name(name) {
+        /*! Instantiates a SensorHistory
+        @param name Name of the history, used as topic prefix for queries
+        */
+        clear();
+    }
+
+    void begin(Scheduler *_pSched, String sourceTopic = "") {
+        /*! Enables queries via pub/sub and optionally attaches the history to a topic
+        @param _pSched Pointer to the muwerk scheduler.
+        @param sourceTopic (optional) Topic of messages containing numeric values that are added
+        to the history, e.g. `temperature/value`.
+        */
+        pSched = _pSched;
+        pSched->subscribe(SCHEDULER_MAIN, name + "/history/get",
+                          [this](String topic, String msg, String originator) {
+                              this->subsMsg(topic, msg, originator);
+                          });
+        if (sourceTopic != "") {
+            pSched->subscribe(SCHEDULER_MAIN, sourceTopic,
+                              [this](String topic, String msg, String originator) {
+                                  this->add((T_FLOAT)atof(msg.c_str()));
+                              });
+        }
+    }
+
+    void clear() {
+        //! Removes all values from the history
+        rawHead = rawCount = 0;
+        minuteHead = minuteCount = 0;
+        hourHead = hourCount = 0;
+        curMinute.count = 0;
+        curHour.count = 0;
+    }
+
+    void add(T_FLOAT value, uint32_t t = 0) {
+        /*! Adds a value to the history
+        @param value The new value
+        @param t (optional) Timestamp in seconds, default is the number of seconds since startup.
+        Timestamps must not decrease.
+        */
+        if (!t) {
+            t = (uint32_t)(millis() / 1000);
+        }
+        rawTime[rawHead] = t;
+        rawVal[rawHead] = value;
+        rawHead = (rawHead + 1) % RAW_N;
+        if (rawCount < RAW_N) {
+            ++rawCount;
+        }
+
+        uint32_t slot = t - t % 60;
+        if (curMinute.count && curMinute.t != slot) {
+            closeMinute();
+        }
+        accumulate(curMinute, slot, value, 1, value, value);
+    }
+
+    unsigned int size(Resolution res) const {
+        /*! Number of completed entries for a resolution
+        @param res Resolution level
+        @return Number of entries available via \ref get
+        */
+        switch (res) {
+        case RAW:
+            return rawCount;
+        case MINUTE:
+            return minuteCount;
+        default:
+            return hourCount;
+        }
+    }
+
+    bool get(Resolution res, unsigned int index, Bucket *pBucket) const {
+        /*! Get an entry of the history
+        @param res Resolution level. For `RAW` the bucket contains a single value.
+        @param index Index of the entry, 0 is the oldest
+        @param pBucket Receives the entry
+        @return false, if index is out of range
+        */
+        if (index >= size(res)) {
+            return false;
+        }
+        switch (res) {
+        case RAW: {
+            unsigned int i = (rawHead + RAW_N - rawCount + index) % RAW_N;
+            pBucket->t = rawTime[i];
+            pBucket->minVal = pBucket->maxVal = pBucket->sum = rawVal[i];
+            pBucket->count = 1;
+            break;
+        }
+        case MINUTE:
+            *pBucket = minutes[(minuteHead + MINUTE_N - minuteCount + index) % MINUTE_N];
+            break;
+        default:
+            *pBucket = hours[(hourHead + HOUR_N - hourCount + index) % HOUR_N];
+            break;
+        }
+        return true;
+    }
+
+    bool current(Resolution res, Bucket *pBucket) const {
+        /*! Get the incomplete bucket that is currently accumulated
+        @param res Resolution level, `MINUTE` or `HOUR`.
+        @param pBucket Receives the current bucket
+        @return false, if there is no current bucket for this resolution
+        */
+        const Bucket &b = res == HOUR ? curHour : curMinute;
+        if (res == RAW || !b.count) {
+            return false;
+        }
+        *pBucket = b;
+        return true;
+    }
+
+    String query(Resolution res, uint32_t from = 0, uint32_t to = 0xffffffff) const {
+        /*! Get a range of the history as json
+        @param res Resolution level
+        @param from (optional) Start of the range in seconds
+        @param to (optional) End of the range in seconds
+        @return Json object `{"resolution":"<res>","data":[...]}`, entries are `[t,min,max,avg]`
+        or `[t,value]` for `RAW`, sorted from oldest to newest.
+        */
+        char buf[24];
+        String json = String("{\"resolution\":\"") + resName(res) + "\",\"data\":[";
+        bool first = true;
+        Bucket b;
+        for (unsigned int i = 0; i < size(res); i++) {
+            get(res, i, &b);
+            if (b.t < from || b.t > to) {
+                continue;
+            }
+            snprintf(buf, sizeof(buf), "%s[%lu,", first ? "" : ",", (unsigned long)b.t);
+            json += buf;
+            json += format(b.minVal);
+            if (res != RAW) {
+                json += "," + format(b.maxVal) + "," + format(b.avg());
+            }
+            json += "]";
+            first = false;
+        }
+        json += "]}";
+        return json;
+    }
+
+  private:
+    static String format(T_FLOAT val) {
+        // json has no representation for nan and inf
+        if (val != val || val - val != 0) {
+            return "null";
+        }
+#if defined(__UNIXOID__) || defined(__RP_PICO__)
+        char buf[32];
+        snprintf(buf, sizeof(buf), val < 1e15 && val > -1e15 ? "%.3f" : "%.6e", (double)val);
+        return buf;
+#else
+        return String((double)val, 3);
+#endif
+    }
+
+    static const char *resName(Resolution res) {
+        return res == RAW ? "raw" : (res == MINUTE ? "minute" : "hour");
+    }
+
+    static void accumulate(Bucket &b, uint32_t slot, T_FLOAT sum, uint32_t count, T_FLOAT minVal,
+                           T_FLOAT maxVal) {
+        if (!b.count) {
+            b.t = slot;
+            b.minVal = minVal;
+            b.maxVal = maxVal;
+            b.sum = sum;
+            b.count = count;
+            return;
+        }
+        if (minVal < b.minVal) {
+            b.minVal = minVal;
+        }
+        if (maxVal > b.maxVal) {
+            b.maxVal = maxVal;
+        }
+        b.sum += sum;
+        b.count += count;
+    }
+
+    void closeMinute() {
+        minutes[minuteHead] = curMinute;
+        minuteHead = (minuteHead + 1) % MINUTE_N;
+        if (minuteCount < MINUTE_N) {
+            ++minuteCount;
+        }
+        uint32_t slot = curMinute.t - curMinute.t % 3600;
+        if (curHour.count && curHour.t != slot) {
+            hours[hourHead] = curHour;
+            hourHead = (hourHead + 1) % HOUR_N;
+            if (hourCount < HOUR_N) {
+                ++hourCount;
+            }
+            curHour.count = 0;
+        }
+        accumulate(curHour, slot, curMinute.sum, curMinute.count, curMinute.minVal,
+                   curMinute.maxVal);
+        curMinute.count = 0;
+    }
+
+    void subsMsg(String topic, String msg, String originator) {
+        const char *p = msg.c_str();
+        Resolution res = RAW;
+        if (!strncmp(p, "minute", 6)) {
+            res = MINUTE;
+        } else if (!strncmp(p, "hour", 4)) {
+            res = HOUR;
+        } else if (strncmp(p, "raw", 3)) {
+            return;
+        }
+        uint32_t from = 0, to = 0xffffffff;
+        const char *sep = strchr(p, ',');
+        if (sep) {
+            from = (uint32_t)strtoul(sep + 1, nullptr, 10);
+            sep = strchr(sep + 1, ',');
+            if (sep) {
+                to = (uint32_t)strtoul(sep + 1, nullptr, 10);
+            }
+        }
+        pSched->publish(name + "/history/" + resName(res), query(res, from, to));
+    }
+};  // SensorHistory
+
+}  // namespace ustd
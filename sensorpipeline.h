@@ -0,0 +1,238 @@
+// sensorpipeline.h - muwerk declarative sensor pipeline
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "scheduler.h"
+#include "sensors.h"
+
+namespace ustd {
+
+/*! \brief muwerk SensorPipeline Class
+
+The SensorPipeline class implements the glue that every sensor driver needs as a reusable
+scheduler task: it periodically reads a raw value from the hardware, runs it through a filter
+(e.g. \ref ustd::sensorprocessor or \ref ustd::sensorfilter), maps it through a calibration
+function (e.g. \ref ustd::numericFunction) and publishes the result.
+
+Values are passed between the stages as T_VALUE, the conversion to a message string happens
+only once, when a value is actually published. A value is published only, if the filter
+generates a new reading and the calibrated value differs from the last published one.
+Filter and calibration stages are optional: pass `nullptr` to skip them.
+
+The following messages are supported:
+
+* publish: `name/<valueTopic>/get` -> `name/<valueTopic>`, last published value.
+* publish: `name/pipeline/get` -> `name/pipeline`, json object with statistics: number of
+  `reads`, `readings` (new values from the filter) and `publishes`, followed by the
+  accumulated time in microseconds spent in each stage (`read_us`, `filter_us`, `calib_us`,
+  `publish_us`).
+
+## Sample of a temperature sensor pipeline:
+
+~~~{.cpp}
+#include <scheduler.h>
+#include <sensorpipeline.h>
+
+ustd::Scheduler sched(10, 16, 32);
+
+const double cx[] = {0., 1023.}, cy[] = {-40., 125.};
+ustd::numericFunction<double> tempCalibration(cx, cy, 2);
+ustd::sensorprocessor tempFilter(10, 600, 0.5);
+ustd::SensorPipeline<> temperature("temperature", [](double *pValue) {
+    *pValue = analogRead(A0);
+    return true;
+}, &tempFilter, &tempCalibration);
+
+void setup() {
+    temperature.begin(&sched, 500000L);  // read every 500ms
+}
+
+void loop() {
+    sched.loop();
+}
+~~~
+
+*/
+template <typename T_VALUE = double, typename T_FILTER = sensorprocessor,
+          typename T_CALIBRATION = numericFunction<T_VALUE>>
+class SensorPipeline {
+  public:
+    //! \brief Hardware read function, returns false if no value is available
+#if defined(__ESP__) || defined(__ESP32__) || defined(__UNIXOID__) || defined(__RP_PICO__)
+    typedef std::function<bool(T_VALUE *pValue)> T_READER;
+#elif defined(__ATTINY__)
+    typedef bool (*T_READER)(T_VALUE *pValue);
+#else
+    typedef ustd::function<bool(T_VALUE *pValue)> T_READER;
+#endif
+
+    // configuration
+    String name;
+    String valueTopic;
+    unsigned int precision;
+
+    // statistics
+    unsigned long reads = 0;
+    unsigned long readings = 0;
+    unsigned long publishes = 0;
+    unsigned long readTime = 0;
+    unsigned long filterTime = 0;
+    unsigned long calibrationTime = 0;
+    unsigned long publishTime = 0;
+
+  private:
+    // muwerk task management
+    Scheduler *pSched = nullptr;
+    int tID = -1;
+
+    // pipeline stages
+    T_READER reader;
+    T_FILTER *pFilter;
+    T_CALIBRATION *pCalibration;
+
+    // runtime state
+    bool bPublished = false;
+    T_VALUE lastValue = 0;
+
+  public:
+    SensorPipeline(String name, T_READER reader, T_FILTER *pFilter = nullptr,
+                   T_CALIBRATION *pCalibration = nullptr, String valueTopic = "value",
+                   unsigned int precision = 2)
+        : name(name), valueTopic(valueTopic), precision(precision), reader(reader),
+          pFilter(pFilter), pCalibration(pCalibration) {
+        /*! Instantiates a SensorPipeline
+        @param name Name of the pipeline, used as task name and topic prefix
+        @param reader Function that reads the raw value from the hardware
+        @param pFilter (optional) Pointer to the filter stage, nullptr for no filtering
+        @param pCalibration (optional) Pointer to the calibration stage, nullptr for none
+        @param valueTopic (optional, default `value`) Topic below name for publishing values
+        @param precision (optional, default 2) Number of decimals of published values
+        */
+    }
+
+    void begin(Scheduler *_pSched, unsigned long minMicroSecs = 1000000L) {
+        /*! Starts the SensorPipeline task
+        @param _pSched Pointer to the muwerk scheduler.
+        @param minMicroSecs (optional, default 1 sec) Interval in microseconds for reading the
+        hardware.
+        */
+        pSched = _pSched;
+        tID = pSched->add([this]() { this->loop(); }, name, minMicroSecs);
+        pSched->subscribe(tID, name + "/#", [this](String topic, String msg, String originator) {
+            this->subsMsg(topic, msg, originator);
+        }, name);
+    }
+
+    int taskID() const {
+        /*! Get the task ID of the pipeline task
+        @return task ID or -1 if the pipeline is not started
+        */
+        return tID;
+    }
+
+    bool value(T_VALUE *pValue) const {
+        /*! Get the last published value
+        @param pValue Receives the last published value
+        @return false, if no value has been published yet
+        */
+        if (!bPublished) {
+            return false;
+        }
+        *pValue = lastValue;
+        return true;
+    }
+
+    void resetStats() {
+        //! Resets the statistics counters
+        reads = 0;
+        readings = 0;
+        publishes = 0;
+        readTime = 0;
+        filterTime = 0;
+        calibrationTime = 0;
+        publishTime = 0;
+    }
+
+    void loop() {
+        /*! Executes one pass of the pipeline: read -> filter -> calibrate -> publish
+         *
+         * This is called by the scheduler, but can also be called directly if the pipeline
+         * is not started with \ref begin.
+         */
+        T_VALUE reading;
+        unsigned long t0 = micros();
+        bool ok = reader(&reading);
+        unsigned long t1 = micros();
+        readTime += timeDiff(t0, t1);
+        if (!ok) {
+            return;
+        }
+        ++reads;
+        if (pFilter) {
+            ok = pFilter->filter(&reading);
+            t0 = micros();
+            filterTime += timeDiff(t1, t0);
+            if (!ok) {
+                return;
+            }
+        } else {
+            t0 = t1;
+        }
+        ++readings;
+        if (pCalibration) {
+            reading = (*pCalibration)(reading);
+            t1 = micros();
+            calibrationTime += timeDiff(t0, t1);
+        } else {
+            t1 = t0;
+        }
+        if (bPublished && reading == lastValue) {
+            return;
+        }
+        lastValue = reading;
+        bPublished = true;
+        publishValue();
+        publishTime += timeDiff(t1, micros());
+    }
+
+  private:
+    void publishValue() {
+        if (pSched) {
+            pSched->publish(name + "/" + valueTopic, format(lastValue), name);
+            ++publishes;
+        }
+    }
+
+    void publishStats() {
+        // 85 chars of text and up to 20 digits per value with 64 bit unsigned long
+        char buf[232];
+        snprintf(buf, sizeof(buf),
+                 "{\"reads\":%lu,\"readings\":%lu,\"publishes\":%lu,\"read_us\":%lu,"
+                 "\"filter_us\":%lu,\"calib_us\":%lu,\"publish_us\":%lu}",
+                 reads, readings, publishes, readTime, filterTime, calibrationTime, publishTime);
+        pSched->publish(name + "/pipeline", buf, name);
+    }
+
+    String format(T_VALUE val) {
+#if defined(__UNIXOID__) || defined(__RP_PICO__)
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", (int)precision, (double)val);
+        return buf;
+#else
+        return String((double)val, (unsigned char)precision);
+#endif
+    }
+
+    void subsMsg(String topic, String msg, String originator) {
+        if (topic == name + "/" + valueTopic + "/get") {
+            if (bPublished) {
+                publishValue();
+            }
+        } else if (topic == name + "/pipeline/get") {
+            publishStats();
+        }
+    }
+};  // SensorPipeline
+
+}  // namespace ustd
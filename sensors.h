@@ -3,6 +3,10 @@
 #include "ustd_platform.h"
 #include "ustd_array.h"
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 namespace ustd {
 #define SENSOR_VALUE_INVALID -999999.0
 
@@ -45,6 +49,47 @@ void loop() {
     }
 }
 ~~~
+
+The sensorprocessor can also adapt the polling rate of the sensor task to the
+    * signal: with \ref setAdaptiveRate the sensorprocessor estimates the rate of
+    * change of the smoothed values and proposes a poll interval that is shortened
+    * during transients and backed off exponentially while the signal is stable.
+    * The interval is fed back to the scheduler with \ref adaptSchedule:
+
+~~~{.cpp}
+ustd::Scheduler sched;
+ustd::sensorprocessor mySensor(10, 3600, 0.1);
+int tID;
+
+void sensorTask() {
+    double value = ReadMyRawSensor();
+    if (mySensor.filter(&value)) {
+        sched.publish("mysensor/value", String(value));
+    }
+    mySensor.adaptSchedule(&sched, tID);
+}
+
+void setup() {
+    // poll between every 100ms and every 60sec
+    mySensor.setAdaptiveRate(100000L, 60000000L);
+    tID = sched.add(sensorTask, "mysensor", 100000L);
+}
+~~~
+
+Single corrupted readings (e.g. I2C glitches) can be removed before smoothing by an
+    * optional Hampel outlier gate: \ref setOutlierFilter keeps a window of the last raw
+    * values and rejects a value, if it deviates from the window's median by more than
+    * threshold times the scaled median absolute deviation (MAD) and more than eps.
+    * The number of rejected values is available in `outliers`.
+
+~~~{.cpp}
+ustd::sensorprocessor mySensor(10, 3600, 0.1);
+
+void setup() {
+    // reject values more than 3 standard deviations off the median of the last 7 readings
+    mySensor.setOutlierFilter(7, 3.0);
+}
+~~~
 */
 
 class sensorprocessor {
@@ -59,6 +104,27 @@ class sensorprocessor {
     double lastVal = SENSOR_VALUE_INVALID;
     unsigned long last;
 
+    // adaptive polling rate
+    unsigned long minPollMicros = 0;
+    unsigned long maxPollMicros = 0;
+    unsigned long pollMicros = 0;
+    double changeRate = 0;
+
+    // outlier gate
+    unsigned int outlierWindow = 0;
+    double outlierThreshold = 3.0;
+    unsigned long outliers = 0;
+
+  private:
+    double prevMean = 0;
+    unsigned long prevMeanMicros = 0;
+    bool bPrevMean = false;
+    bool bPollChanged = false;
+    double *pWindow = nullptr;  // ring buffer followed by its sorted copy
+    unsigned int windowFill = 0;
+    unsigned int windowHead = 0;
+
+  public:
     sensorprocessor(unsigned int smoothInterval = 5, int unsigned pollTimeSec = 60,
                     double eps = 0.1)
         : smoothInterval{smoothInterval}, pollTimeSec{pollTimeSec}, eps{eps} {
@@ -74,6 +140,64 @@ class sensorprocessor {
         reset();
     }
 
+    sensorprocessor(const sensorprocessor &src) {
+        /*! Creates a copy of a sensorprocessor including its outlier window
+        @param src Source sensorprocessor
+        */
+        *this = src;
+    }
+
+    ~sensorprocessor() {
+        if (pWindow) {
+            free(pWindow);
+        }
+    }
+
+    sensorprocessor &operator=(const sensorprocessor &src) {
+        /*! Assigns a sensorprocessor including its outlier window
+        @param src Source sensorprocessor
+        */
+        if (this == &src) {
+            return *this;
+        }
+        double *pOld = pWindow;
+        noVals = src.noVals;
+        smoothInterval = src.smoothInterval;
+        pollTimeSec = src.pollTimeSec;
+        sum = src.sum;
+        eps = src.eps;
+        first = src.first;
+        meanVal = src.meanVal;
+        lastVal = src.lastVal;
+        last = src.last;
+        minPollMicros = src.minPollMicros;
+        maxPollMicros = src.maxPollMicros;
+        pollMicros = src.pollMicros;
+        changeRate = src.changeRate;
+        outlierWindow = src.outlierWindow;
+        outlierThreshold = src.outlierThreshold;
+        outliers = src.outliers;
+        prevMean = src.prevMean;
+        prevMeanMicros = src.prevMeanMicros;
+        bPrevMean = src.bPrevMean;
+        bPollChanged = src.bPollChanged;
+        windowFill = src.windowFill;
+        windowHead = src.windowHead;
+        pWindow = nullptr;
+        if (src.pWindow) {
+            pWindow = (double *)malloc(2 * outlierWindow * sizeof(double));
+            if (pWindow) {
+                memcpy(pWindow, src.pWindow, 2 * outlierWindow * sizeof(double));
+            } else {
+                outlierWindow = 0;
+            }
+        }
+        if (pOld) {
+            free(pOld);
+        }
+        return *this;
+    }
+
     bool filter(double *pvalue) {
         /*! The sensorprocessor filter function. (double float version)
         @param *pvalue the current raw sensor reading. The filter function uses
@@ -85,28 +209,35 @@ class sensorprocessor {
         return value of false indicates, that no new sensor reading is
         available.
         */
-        meanVal = (meanVal * noVals + (*pvalue)) / (noVals + 1);
-        if (noVals < smoothInterval) {
-            ++noVals;
-        }
-        double delta = lastVal - meanVal;
-        if (delta < 0.0) {
-            delta = (-1.0) * delta;
-        }
-        if (delta > eps || first) {
-            first = false;
-            lastVal = meanVal;
-            *pvalue = meanVal;
-            last = millis();
-            return true;
+        if (pWindow && isOutlier(*pvalue)) {
+            // the outlier is dropped from the mean, periodic readings are still due
+            ++outliers;
         } else {
-            if (pollTimeSec != 0) {
-                if (timeDiff(last, millis()) > pollTimeSec * 1000L) {
-                    *pvalue = meanVal;
-                    last = millis();
-                    lastVal = meanVal;
-                    return true;
-                }
+            meanVal = (meanVal * noVals + (*pvalue)) / (noVals + 1);
+            if (noVals < smoothInterval) {
+                ++noVals;
+            }
+            if (maxPollMicros) {
+                adaptRate(meanVal);
+            }
+            double delta = lastVal - meanVal;
+            if (delta < 0.0) {
+                delta = (-1.0) * delta;
+            }
+            if (delta > eps || first) {
+                first = false;
+                lastVal = meanVal;
+                *pvalue = meanVal;
+                last = millis();
+                return true;
+            }
+        }
+        if (pollTimeSec != 0 && !first) {
+            if (timeDiff(last, millis()) > pollTimeSec * 1000L) {
+                *pvalue = meanVal;
+                last = millis();
+                lastVal = meanVal;
+                return true;
             }
         }
         return false;
@@ -139,6 +270,92 @@ class sensorprocessor {
         meanVal = 0;
         lastVal = SENSOR_VALUE_INVALID;
         last = millis();
+        changeRate = 0;
+        bPrevMean = false;
+        pollMicros = maxPollMicros ? minPollMicros : 0;
+        bPollChanged = maxPollMicros != 0;
+        windowFill = 0;
+        windowHead = 0;
+        outliers = 0;
+    }
+
+    bool setOutlierFilter(unsigned int window, double threshold = 3.0) {
+        /*! Enable the Hampel outlier gate
+         *
+         * Raw values are checked before smoothing: a value is rejected, if its distance to
+         * the median of the last window values (including itself) is larger than
+         * threshold * 1.4826 * MAD (median absolute deviation) and larger than eps. The
+         * factor 1.4826 scales the MAD to a standard deviation for normally distributed
+         * noise. Rejected values do not change the smoothed value and increment `outliers`.
+         * \ref filter still returns the smoothed value for them, if a periodic reading is
+         * due (pollTimeSec).
+         * The gate starts working, once window values have been received.
+         *
+        @param window Number of raw values in the window (3 or more), 0 disables the gate.
+        @param threshold (optional, default 3.0) Rejection threshold in standard deviations.
+        @return false, if the memory for the window could not be allocated.
+        */
+        if (pWindow) {
+            free(pWindow);
+            pWindow = nullptr;
+        }
+        outlierWindow = 0;
+        outlierThreshold = threshold;
+        windowFill = 0;
+        windowHead = 0;
+        if (window < 3) {
+            return window == 0;
+        }
+        pWindow = (double *)malloc(2 * window * sizeof(double));
+        if (!pWindow) {
+            return false;
+        }
+        outlierWindow = window;
+        return true;
+    }
+
+    void setAdaptiveRate(unsigned long minMicroSecs, unsigned long maxMicroSecs) {
+        /*! Enable adaptive polling rate
+         *
+         * The sensorprocessor estimates the rate of change of the smoothed values computed by
+         * \ref filter. If the smoothed value changed by at least eps/2 since the previous one,
+         * the poll interval is set so that the expected change per poll is eps/2. Otherwise the
+         * poll interval is doubled. The interval never grows by more than factor 2 per poll.
+         * The resulting interval is available as \ref pollInterval and can be passed to the
+         * scheduler with \ref adaptSchedule.
+         *
+        @param minMicroSecs Shortest poll interval in microseconds
+        @param maxMicroSecs Longest poll interval in microseconds. 0 disables adaptive polling.
+        */
+        minPollMicros = minMicroSecs ? minMicroSecs : 1;
+        maxPollMicros = maxMicroSecs && maxMicroSecs < minMicroSecs ? minMicroSecs : maxMicroSecs;
+        pollMicros = maxPollMicros ? minPollMicros : 0;
+        bPollChanged = maxPollMicros != 0;
+        bPrevMean = false;
+    }
+
+    unsigned long pollInterval() const {
+        /*! Proposed poll interval
+        @return Poll interval in microseconds, 0 if adaptive polling is not enabled.
+        */
+        return pollMicros;
+    }
+
+    template <typename T_SCHED> bool adaptSchedule(T_SCHED *pSched, int taskID) {
+        /*! Reschedule a task according to the proposed poll interval
+         *
+         * The task is only rescheduled, if the proposed poll interval has changed since the
+         * last call.
+         *
+        @param pSched Pointer to the muwerk scheduler
+        @param taskID ID of the task that polls the sensor
+        @return true, if the task has been rescheduled.
+        */
+        if (!bPollChanged || !pollMicros) {
+            return false;
+        }
+        bPollChanged = false;
+        return pSched->reschedule(taskID, pollMicros);
     }
 
     void update(unsigned int _smoothInterval = 5, int unsigned _pollTimeSec = 60,
@@ -160,178 +377,1086 @@ class sensorprocessor {
         eps = _eps;
         reset();
     }
+
+  private:
+    bool isOutlier(double raw) {
+        double *pRing = pWindow;
+        double *pSorted = pWindow + outlierWindow;
+        unsigned int i;
+        // remove the oldest value from the sorted window
+        if (windowFill == outlierWindow) {
+            double old = pRing[windowHead];
+            for (i = 0; i < windowFill - 1 && pSorted[i] != old; i++) {
+            }
+            for (; i < windowFill - 1; i++) {
+                pSorted[i] = pSorted[i + 1];
+            }
+            --windowFill;
+        }
+        pRing[windowHead] = raw;
+        windowHead = (windowHead + 1) % outlierWindow;
+        // insert the new value into the sorted window
+        for (i = windowFill; i > 0 && pSorted[i - 1] > raw; i--) {
+            pSorted[i] = pSorted[i - 1];
+        }
+        pSorted[i] = raw;
+        ++windowFill;
+        if (windowFill < outlierWindow) {
+            return false;
+        }
+        unsigned int mid = windowFill / 2;
+        double median = windowFill % 2 ? pSorted[mid] : (pSorted[mid - 1] + pSorted[mid]) / 2.0;
+        // the absolute deviations grow from the median outwards on both sides of the
+        // sorted window, so the MAD is found by merging both sides up to the middle.
+        int lo = (int)mid - 1;
+        unsigned int hi = windowFill % 2 ? mid + 1 : mid;
+        double dev = windowFill % 2 ? 0.0 : -1.0, prevDev = 0.0;
+        unsigned int k = windowFill % 2 ? 1 : 0;
+        for (; k <= mid; k++) {
+            prevDev = dev;
+            double dl = lo >= 0 ? median - pSorted[lo] : -1.0;
+            double dh = hi < windowFill ? pSorted[hi] - median : -1.0;
+            if (dh < 0.0 || (dl >= 0.0 && dl <= dh)) {
+                dev = dl;
+                --lo;
+            } else {
+                dev = dh;
+                ++hi;
+            }
+        }
+        double mad = windowFill % 2 ? dev : (prevDev + dev) / 2.0;
+        double limit = outlierThreshold * 1.4826 * mad;
+        if (limit < eps) {
+            limit = eps;
+        }
+        double delta = raw - median;
+        if (delta < 0.0) {
+            delta = (-1.0) * delta;
+        }
+        return delta > limit;
+    }
+
+    void adaptRate(double mean) {
+        unsigned long now = micros();
+        if (bPrevMean) {
+            // use the smoothed value, raw sensor noise would pin the interval at the minimum
+            double change = mean - prevMean;
+            if (change < 0.0) {
+                change = (-1.0) * change;
+            }
+            double dt = timeDiff(prevMeanMicros, now) / 1000000.0;
+            changeRate = dt > 0.0 ? change / dt : 0.0;
+            // the interval grows back by at most factor 2 per poll
+            unsigned long next = pollMicros > maxPollMicros / 2 ? maxPollMicros : pollMicros * 2;
+            if (change >= eps / 2.0) {
+                // aim for an expected change of eps/2 per poll
+                double target = dt > 0.0 ? eps / 2.0 / changeRate * 1000000.0 : 0.0;
+                if (target < (double)next) {
+                    next = target < (double)minPollMicros ? minPollMicros : (unsigned long)target;
+                }
+            }
+            if (next != pollMicros) {
+                pollMicros = next;
+                bPollChanged = true;
+            }
+        }
+        prevMean = mean;
+        prevMeanMicros = now;
+        bPrevMean = true;
+    }
 };
 
-/*!  \brief muwerk numericFunction class
- *
- * numericFunktion approximates arbitrary values x of a function f(x) defined
- * by a number points (x,y) using linear approximation to nearest neighbour-points.
- *
- * Example:
+/*!  \brief muwerk fixedsensorprocessor class
+
+fixedsensorprocessor is a fixed-point implementation of \ref sensorprocessor for
+    * platforms without floating point unit (AVR, ESP8266). It offers the same API,
+    * the same smoothing and the same eps/pollTimeSec semantics, but all filter
+    * arithmetic is done with integers.
+    *
+    * Values are stored as signed fixed-point numbers of type T_FIXED with FRAC_BITS
+    * fractional bits (default: Q16.16 in an int32_t). The range of representable values
+    * is therefore +/- 2^(bits(T_FIXED)-FRAC_BITS-1), for the default +/-32767 with a
+    * resolution of 1/65536. T_ACC must be able to hold the product of two T_FIXED values.
+    *
+    * The per-sample divide of sensorprocessor is replaced by a multiplication with a
+    * precomputed reciprocal of the averaging divisor. The reciprocal only changes while
+    * the filter history fills up, so after smoothInterval samples no division is
+    * executed at all.
+    *
+    * Raw readings can be fed as `long` (e.g. ADC values) without any floating point
+    * operation, as `double` for compatibility with \ref sensorprocessor, or directly as
+    * fixed-point values via \ref filterFixed().
+    *
+    * Example:
 
 ~~~{.cpp}
-    // Define a numeric function for (0,9), (1,3), (2,2.8), (3,1)
-    const float cx[] = {0., 1., 2., 3.}, cy[] = {9, 3, 2.8, 1};
-    // generate model, extrapolate for x outside of (0...3)
-    ustd::numericFunction<float> f(cx, cy, sizeof(cx) / sizeof(float), true);
+void setup() {
+    // same parameters as sensorprocessor: average over 10 values, generate
+    // a reading at least every 3600sec or on changes bigger than 0.1
+    ustd::fixedsensorprocessor<> mySensor(10,3600,0.1)
+}
 
-    for (float x = -1.0; x < 5.0; x+=0.1) {
-        printf("%f->%f\n", x, f(x));
+void loop() {
+    long rawValue=analogRead(A0);
+    if mySensor.filter(&rawValue) {
+        printf("We got a new, filtered reading: %ld\n", rawValue);
     }
-
-    // generates:
-    ...
-    -0.300000 -> 10.800000
-    -0.200000 -> 10.200000
-    -0.100000 -> 9.600000
-    0.000000 -> 9.000000
-    0.100000 -> 8.400000
-    0.200000 -> 7.800000
-    0.300000 -> 7.200000
-    ...
-    0.800000 -> 4.200000
-    0.900000 -> 3.600000
-    1.000000 -> 3.000000
-    1.100000 -> 2.980000
-    1.200000 -> 2.960000
-    1.300000 -> 2.940000
-    ...
-    1.800000 -> 2.840000
-    1.900000 -> 2.820000
-    2.000000 -> 2.800000
-    2.100000 -> 2.620000
-    2.200000 -> 2.440000
-    ...
-    2.800000 -> 1.360000
-    2.900000 -> 1.180000
-    3.000000 -> 1.000000
-    3.100000 -> 0.940000
-    3.200000 -> 0.880000
-    ...
+}
 ~~~
 */
-template <typename T_FLOAT> class numericFunction {
+template <typename T_FIXED = int32_t, unsigned int FRAC_BITS = 16, typename T_ACC = int64_t>
+class fixedsensorprocessor {
   public:
-    ustd::array<T_FLOAT> x, y;
-    T_FLOAT minX, minY, maxX, maxY;
-    unsigned int len;
-    bool dir;
-    bool extrapolate;
-    numericFunction(const T_FLOAT px[], const T_FLOAT py[], unsigned int count,
-                    bool _extrapolate = false) {
-        /*! Instatiate a numericFunction with point px and py.
+    unsigned int noVals = 0;
+    unsigned int smoothInterval;
+    unsigned int pollTimeSec;
+    T_FIXED eps;
+    bool first = true;
+    T_FIXED meanVal = 0;
+    T_FIXED lastVal = 0;
+    T_FIXED recip;
+    unsigned long last;
 
-        @param px array of length count of x-values.
-        @param py corresponding array of y-values, f(px[i])=py[i]
-        @param count array member count of both px and py
-        @param _extrapolate false: if px is ouside of the defined points, x<min(px) gives py[0],
-                            x>max(px) gives py[count-1], on true linear approximation is used.
+    fixedsensorprocessor(unsigned int smoothInterval = 5, int unsigned pollTimeSec = 60,
+                         double eps = 0.1)
+        : smoothInterval{smoothInterval}, pollTimeSec{pollTimeSec} {
+        /*! Creates a new fixedsensorprocessor
+        @param smoothInterval The size of the interval of sensor value history
+        that are being averaged using exponential decay.
+        @param pollTimeSec If this is !=0, a valid sensor reading is generated
+        at least every pollTimeSec, regardless of value changes.
+        @param eps The minimal change required for the smoothed sensor value in
+        order to create a new valid reading. Useful for supressing small
+        fluctuations. (Converted once to fixed-point.)
         */
-
-        extrapolate = _extrapolate;
-        len = 0;
-        for (unsigned int i = 0; i < count; i++) {
-            if (i > 0) {
-                // enforce strict monotony:
-                if (px[i] <= x[len - 1])
-                    continue;
-                if (py[i] == y[len - 1])
-                    continue;
-
-                if (len == 1)
-                    dir = (py[i] > y[len - 1]);
-                if ((py[i] > y[len - 1]) != dir)
-                    continue;
-            }
-            x[len] = px[i];
-            y[len] = py[i];
-            if (i == 0 || minX > x[len])
-                minX = x[len];
-            if (i == 0 || minY > y[len])
-                minY = y[len];
-            if (i == 0 || maxX < x[len])
-                maxX = x[len];
-            if (i == 0 || maxY < y[len])
-                maxY = y[len];
-            ++len;
-        }
+        this->eps = toFixed(eps);
+        reset();
     }
 
-    static T_FLOAT min(ustd::array<T_FLOAT> ar) {
-        /*! get minimum value of array ar
-        @param ar ustd::array
+    static T_FIXED toFixed(double value) {
+        /*! Convert a double to the fixed-point representation (rounded to nearest)
+        @param value Value to be converted
+        @return fixed-point representation of value
         */
-        T_FLOAT minVal = 0.0;
-        for (unsigned int i = 0; i < ar.length(); i++) {
-            if (i == 0 || ar[i] < minVal)
-                minVal = ar[i];
-        }
-        return minVal;
+        return (T_FIXED)(value * (double)((T_ACC)1 << FRAC_BITS) + (value < 0.0 ? -0.5 : 0.5));
     }
 
-    static T_FLOAT max(ustd::array<T_FLOAT> ar) {
-        /*! get maximum value of array ar
-        @param ar ustd::array
+    static T_FIXED toFixed(long value) {
+        /*! Convert a long integer to the fixed-point representation (no floating point involved)
+        @param value Value to be converted
+        @return fixed-point representation of value
         */
-        T_FLOAT maxVal = 0.0;
-        for (unsigned int i = 0; i < ar.length(); i++) {
-            if (i == 0 || ar[i] > maxVal)
-                maxVal = ar[i];
-        }
-        return maxVal;
+        return (T_FIXED)((T_ACC)value * ((T_ACC)1 << FRAC_BITS));
     }
 
-    static void rescale(ustd::array<T_FLOAT> *par, T_FLOAT *pminX, T_FLOAT *pmaxX, T_FLOAT newMin,
-                        T_FLOAT newMax) {
-        /*! inplace rescale an array so that it conforms to newMin and newMax
-
-        Note: current minimum and maximum must be given to pminX and pmaxX (see \ref min(), \ref
-        max() ).
-
-        @param par point to ustd::array to be rescaled
-        @param pminX pointer to mimimum value of array-members in ar, will be overwriten with new
-        actual minimum.
-        @param pmaxX pointer to maximum value of array-members in ar, will be overwriten with new
-        actual maximum.
-        @param newMin The entire array ar is transformed linearily so that the new minimum is newMin
-        @param newMax The entire array ar is transformed linearily so that the new maximum is
-        newMax.
+    static double toDouble(T_FIXED value) {
+        /*! Convert a fixed-point value to double
+        @param value fixed-point value to be converted
+        @return double representation of value
         */
-        T_FLOAT dx;
-        T_FLOAT newMinX, newMaxX;
-        unsigned int len = (*par).length();
-        if (len < 2 || *pminX == *pmaxX)
-            dx = 1;
-        else
-            dx = (*pmaxX - *pminX);
-        T_FLOAT ndx = newMax - newMin;
-        for (unsigned int i = 0; i < len; i++) {
-            T_FLOAT xi = (*par)[i];
-            (*par)[i] = (xi - *pminX) / dx * ndx + newMin;
-            if (i == 0 || newMinX > xi)
-                newMinX = xi;
-            if (i == 0 || newMaxX < xi)
-                newMaxX = xi;
-        }
-        *pminX = newMinX;
-        *pmaxX = newMaxX;
+        return (double)value / (double)((T_ACC)1 << FRAC_BITS);
     }
 
-    void rescaleX(T_FLOAT newMin, T_FLOAT newMax) {
-        /*! Rescale x-axis linearily
-
-        @param newMin new start of x-values
-        @param newMax new end of x-values
+    static long toLong(T_FIXED value) {
+        /*! Convert a fixed-point value to long integer, truncating towards zero like a cast
+        from double does.
+        @param value fixed-point value to be converted
+        @return integer part of value
         */
-        rescale(&x, &minX, &maxX, newMin, newMax);
+        return (long)(value / ((T_FIXED)1 << FRAC_BITS));
     }
-    void rescaleY(T_FLOAT newMin, T_FLOAT newMax) {
+
+    bool filterFixed(T_FIXED *pvalue) {
+        /*! The fixedsensorprocessor filter function. (native fixed-point version)
+        @param *pvalue the current raw sensor reading in fixed-point representation.
+        The filter function uses exponential smoothing to filter the value and, if a
+        valid new value is available, changes *pvalue.
+        @return on true, *pvalue contains a new, smoothed valid sensor reading.
+        A new reading is generated by either pollTimeSec (!=0) seconds have been
+        passed, or the smoothed value has changed more than espilon eps. A
+        return value of false indicates, that no new sensor reading is
+        available.
+        */
+        // meanVal = (meanVal * noVals + value) / (noVals + 1), rearranged to
+        // meanVal += (value - meanVal) * recip with recip = 1 / (noVals + 1)
+        T_ACC acc = (T_ACC)(*pvalue - meanVal) * recip;
+        meanVal += (T_FIXED)((acc + ((T_ACC)1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+        if (noVals < smoothInterval) {
+            ++noVals;
+            recip = calcRecip(noVals + 1);
+        }
+        T_FIXED delta = lastVal - meanVal;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        if (delta > eps || first) {
+            first = false;
+            lastVal = meanVal;
+            *pvalue = meanVal;
+            last = millis();
+            return true;
+        } else {
+            if (pollTimeSec != 0) {
+                if (timeDiff(last, millis()) > pollTimeSec * 1000L) {
+                    *pvalue = meanVal;
+                    last = millis();
+                    lastVal = meanVal;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool filter(double *pvalue) {
+        /*! The fixedsensorprocessor filter function. (double float version)
+
+        This version is provided for compatibility with \ref sensorprocessor. It
+        converts from and to double, use \ref filter(long *) or \ref filterFixed()
+        to avoid any floating point operation.
+
+        @param *pvalue the current raw sensor reading. If a valid new value is
+        available, *pvalue is changed to the smoothed value.
+        @return on true, *pvalue contains a new, smoothed valid sensor reading.
+        */
+        T_FIXED tval = toFixed(*pvalue);
+        bool ret = filterFixed(&tval);
+        if (ret) {
+            *pvalue = toDouble(tval);
+        }
+        return ret;
+    }
+
+    bool filter(long *plvalue) {
+        /*! The fixedsensorprocessor filter function. (long integer version)
+        @param *plvalue the current raw sensor reading. If a valid new value is
+        available, *plvalue is changed to the smoothed value. No floating point
+        operations are used.
+        @return on true, *plvalue contains a new, smoothed valid sensor reading.
+        */
+        T_FIXED tval = toFixed(*plvalue);
+        bool ret = filterFixed(&tval);
+        if (ret) {
+            *plvalue = toLong(tval);
+        }
+        return ret;
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        noVals = 0;
+        recip = calcRecip(1);
+        first = true;
+        meanVal = 0;
+        lastVal = 0;
+        last = millis();
+    }
+
+    void update(unsigned int _smoothInterval = 5, int unsigned _pollTimeSec = 60,
+                double _eps = 0.1) {
+        /*! Update filter parameters and reset.
+         *
+         * Note: this is equivalent of recreating a new instance.
+         *
+        @param _smoothInterval The size of the interval of sensor value history
+        that are being averaged using exponential decay.
+        @param _pollTimeSec If this is !=0, a valid sensor reading is generated
+        at least every pollTimeSec, regardless of value changes.
+        @param _eps The minimal change required for the smoothed sensor value in
+        order to create a new valid reading. Useful for supressing small
+        fluctuations.
+        */
+        smoothInterval = _smoothInterval;
+        pollTimeSec = _pollTimeSec;
+        eps = toFixed(_eps);
+        reset();
+    }
+
+  private:
+    static T_FIXED calcRecip(unsigned int divisor) {
+        // 1 / divisor in fixed-point, rounded to nearest
+        return (T_FIXED)((((T_ACC)1 << FRAC_BITS) + divisor / 2) / divisor);
+    }
+};
+
+/*!  \brief muwerk sensorbank class
+
+sensorbank implements the filter of \ref sensorprocessor for N channels at once.
+    * All channel state is kept in structure-of-arrays layout (one contiguous array per
+    * filter variable), so that a single call of \ref filter() updates all channels in
+    * tight loops that the compiler can vectorize. Compared to N sensorprocessor objects
+    * this saves memory, improves cache locality and calls millis() only once per tick.
+    *
+    * Each channel has its own smoothInterval, pollTimeSec and eps and follows exactly
+    * the same rules as sensorprocessor for generating new readings. The result of a
+    * filter pass is a bitmask with one bit per channel, stored in an array of
+    * \ref maskWords 32 bit words.
+    *
+    * Example:
+
+~~~{.cpp}
+ustd::sensorbank<64> bank(10, 3600, 0.1);  // 64 channels, all with the same parameters
+uint32_t newReadings[ustd::sensorbank<64>::maskWords];
+double values[64];
+
+void setup() {
+    bank.update(7, 10, 600, 0.5);  // channel 7 uses different parameters
+}
+
+void loop() {
+    readAllMyChannels(values);
+    if (bank.filter(values, newReadings)) {
+        for (unsigned int i = 0; i < 64; i++) {
+            if (ustd::sensorbank<64>::isSet(newReadings, i)) {
+                printf("Channel %d: new reading %f\n", i, values[i]);
+            }
+        }
+    }
+}
+~~~
+*/
+template <unsigned int N, typename T_FLOAT = double> class sensorbank {
+  public:
+    static const unsigned int maskWords = (N + 31) / 32;  //!< Number of words in a bitmask
+
+    T_FLOAT meanVal[N];
+    T_FLOAT lastVal[N];
+    T_FLOAT recip[N];
+    T_FLOAT eps[N];
+    unsigned int noVals[N];
+    unsigned int smoothInterval[N];
+    unsigned int pollTimeSec[N];
+    unsigned long last[N];
+    uint32_t first[maskWords];
+    unsigned int filling;
+
+    sensorbank(unsigned int smoothInterval = 5, unsigned int pollTimeSec = 60, double eps = 0.1) {
+        /*! Creates a new sensorbank with N channels sharing the same parameters
+        @param smoothInterval The size of the interval of sensor value history
+        that are being averaged using exponential decay.
+        @param pollTimeSec If this is !=0, a valid sensor reading is generated
+        at least every pollTimeSec, regardless of value changes.
+        @param eps The minimal change required for the smoothed sensor value in
+        order to create a new valid reading.
+        */
+        for (unsigned int i = 0; i < N; i++) {
+            this->smoothInterval[i] = smoothInterval;
+            this->pollTimeSec[i] = pollTimeSec;
+            this->eps[i] = (T_FLOAT)eps;
+        }
+        for (unsigned int w = 0; w < maskWords; w++) {
+            first[w] = 0;
+        }
+        reset();
+    }
+
+    static bool isSet(const uint32_t *pmask, unsigned int channel) {
+        /*! Test if the bit of a channel is set in a bitmask returned by \ref filter()
+        @param pmask bitmask of \ref maskWords words
+        @param channel channel number 0..N-1
+        @return true, if the bit of the channel is set
+        */
+        return (pmask[channel / 32] >> (channel % 32)) & 1;
+    }
+
+    unsigned int filter(T_FLOAT *pvalues, uint32_t *pmask) {
+        /*! The sensorbank filter function, processes one tick of all channels.
+        @param *pvalues array of N current raw sensor readings. For each channel that
+        generates a new valid reading, the corresponding value is replaced by the
+        smoothed value. All other values are left untouched.
+        @param *pmask array of \ref maskWords words that receives a bitmask of the
+        channels that generated a new reading.
+        @return number of channels that generated a new reading.
+        */
+        // exponential smoothing of all channels, branch free:
+        // meanVal = (meanVal * noVals + value) / (noVals + 1) == meanVal + (value - meanVal) * recip
+        for (unsigned int i = 0; i < N; i++) {
+            meanVal[i] += (pvalues[i] - meanVal[i]) * recip[i];
+        }
+        if (filling) {
+            // only while the history of at least one channel fills up
+            filling = 0;
+            for (unsigned int i = 0; i < N; i++) {
+                if (noVals[i] < smoothInterval[i]) {
+                    ++noVals[i];
+                    recip[i] = (T_FLOAT)1 / (T_FLOAT)(noVals[i] + 1);
+                    if (noVals[i] < smoothInterval[i]) {
+                        ++filling;
+                    }
+                }
+            }
+        }
+        unsigned long now = millis();
+        unsigned int count = 0;
+        for (unsigned int w = 0; w < maskWords; w++) {
+            unsigned int base = w * 32;
+            unsigned int end = base + 32 < N ? base + 32 : N;
+            uint32_t mask = first[w];
+            for (unsigned int i = base; i < end; i++) {
+                T_FLOAT delta = lastVal[i] - meanVal[i];
+                if (delta < 0) {
+                    delta = -delta;
+                }
+                mask |= (uint32_t)(delta > eps[i]) << (i - base);
+            }
+            for (unsigned int i = base; i < end; i++) {
+                if (pollTimeSec[i] != 0 && timeDiff(last[i], now) > pollTimeSec[i] * 1000L) {
+                    mask |= (uint32_t)1 << (i - base);
+                }
+            }
+            if (mask) {
+                for (unsigned int i = base; i < end; i++) {
+                    if ((mask >> (i - base)) & 1) {
+                        lastVal[i] = meanVal[i];
+                        pvalues[i] = meanVal[i];
+                        last[i] = now;
+                        ++count;
+                    }
+                }
+            }
+            first[w] = 0;
+            pmask[w] = mask;
+        }
+        return count;
+    }
+
+    void reset() {
+        /*! Delete the filter history of all channels */
+        for (unsigned int i = 0; i < N; i++) {
+            reset(i);
+        }
+    }
+
+    void reset(unsigned int channel) {
+        /*! Delete the filter history of one channel
+        @param channel channel number 0..N-1
+        */
+        if (channel >= N) {
+            return;
+        }
+        noVals[channel] = 0;
+        recip[channel] = 1;
+        meanVal[channel] = 0;
+        lastVal[channel] = (T_FLOAT)SENSOR_VALUE_INVALID;
+        last[channel] = millis();
+        first[channel / 32] |= (uint32_t)1 << (channel % 32);
+        filling = N;
+    }
+
+    void update(unsigned int channel, unsigned int _smoothInterval = 5,
+                unsigned int _pollTimeSec = 60, double _eps = 0.1) {
+        /*! Update filter parameters of one channel and reset its history.
+        @param channel channel number 0..N-1
+        @param _smoothInterval The size of the interval of sensor value history
+        that are being averaged using exponential decay.
+        @param _pollTimeSec If this is !=0, a valid sensor reading is generated
+        at least every pollTimeSec, regardless of value changes.
+        @param _eps The minimal change required for the smoothed sensor value in
+        order to create a new valid reading.
+        */
+        if (channel >= N) {
+            return;
+        }
+        smoothInterval[channel] = _smoothInterval;
+        pollTimeSec[channel] = _pollTimeSec;
+        eps[channel] = (T_FLOAT)_eps;
+        reset(channel);
+    }
+};
+
+/*!  \brief muwerk exponentialFilter class
+
+Filter engine implementing the exponential smoothing of \ref sensorprocessor. Filter engines
+share a common interface and can be plugged into \ref sensorfilter at compile time:
+
+* `bool filter(T_FLOAT *pvalue)`: feed a raw value, on return *pvalue contains the filtered
+  value. A return value of `false` indicates that the engine has no output for this input.
+* `void reset()`: delete the filter history.
+
+All engines use a fixed amount of memory and do no dynamic allocation.
+*/
+template <typename T_FLOAT = double> class exponentialFilter {
+  public:
+    unsigned int noVals = 0;
+    unsigned int smoothInterval;
+    T_FLOAT meanVal = 0;
+
+    exponentialFilter(unsigned int smoothInterval = 5) : smoothInterval{smoothInterval} {
+        /*! Creates a new exponentialFilter
+        @param smoothInterval The size of the interval of sensor value history
+        that are being averaged using exponential decay.
+        */
+    }
+
+    bool filter(T_FLOAT *pvalue) {
+        /*! Feed a raw value into the filter
+        @param *pvalue raw value, replaced by the smoothed value.
+        @return always true
+        */
+        meanVal = (meanVal * noVals + (*pvalue)) / (noVals + 1);
+        if (noVals < smoothInterval) {
+            ++noVals;
+        }
+        *pvalue = meanVal;
+        return true;
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        noVals = 0;
+        meanVal = 0;
+    }
+};
+
+/*!  \brief muwerk movingAverageFilter class
+
+Filter engine (see \ref exponentialFilter for the interface) that calculates the arithmetic
+mean of the last N values. The window is kept in a ring buffer together with a running sum,
+so each value costs O(1) regardless of the window size. To avoid accumulating rounding
+errors, the running sum is recalculated from the window each time the ring buffer wraps
+around. As long as less than N values have been received, the mean over all values is
+returned.
+*/
+template <unsigned int N, typename T_FLOAT = double> class movingAverageFilter {
+  public:
+    T_FLOAT window[N];
+    T_FLOAT sum = 0;
+    unsigned int count = 0;
+    unsigned int index = 0;
+
+    movingAverageFilter() {
+        /*! Creates a new movingAverageFilter over a window of N values */
+    }
+
+    bool filter(T_FLOAT *pvalue) {
+        /*! Feed a raw value into the filter
+        @param *pvalue raw value, replaced by the mean of the window.
+        @return always true
+        */
+        if (count < N) {
+            ++count;
+        } else {
+            sum -= window[index];
+        }
+        window[index] = *pvalue;
+        sum += *pvalue;
+        if (++index == N) {
+            index = 0;
+            sum = 0;
+            for (unsigned int i = 0; i < N; i++) {
+                sum += window[i];
+            }
+        }
+        *pvalue = sum / (T_FLOAT)count;
+        return true;
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        sum = 0;
+        count = 0;
+        index = 0;
+    }
+};
+
+/*!  \brief muwerk medianFilter class
+
+Filter engine (see \ref exponentialFilter for the interface) that calculates the running
+median of the last N values. Spikes and single bad readings are completely suppressed as long
+as they make up less than half of the window.
+
+The implementation keeps the window in a ring buffer and maintains a max-heap of the values
+below the median and a min-heap of the values above it within a single index array (double
+heap). Each value costs O(log N), memory is fixed. As long as less than N values have been
+received, the median over all values is returned. For an even number of values, one of the
+two middle values is returned.
+*/
+template <unsigned int N, typename T_FLOAT = double> class medianFilter {
+  public:
+    T_FLOAT window[N];  // ring buffer of values
+    int pos[N];         // heap position of each ring buffer slot
+    int heapIdx[N];     // max heap / median / min heap of ring buffer indices
+    unsigned int count;
+    unsigned int index;
+
+    medianFilter() {
+        /*! Creates a new medianFilter over a window of N values */
+        reset();
+    }
+
+    bool filter(T_FLOAT *pvalue) {
+        /*! Feed a raw value into the filter
+        @param *pvalue raw value, replaced by the median of the window.
+        @return always true
+        */
+        bool isNew = count < N;
+        int p = pos[index];
+        T_FLOAT old = window[index];
+        window[index] = *pvalue;
+        if (++index == N) {
+            index = 0;
+        }
+        if (isNew) {
+            ++count;
+        }
+        if (p > 0) {
+            // new value is in the min heap
+            if (!isNew && old < *pvalue) {
+                minSortDown(p * 2);
+            } else if (minSortUp(p)) {
+                maxSortDown(-1);
+            }
+        } else if (p < 0) {
+            // new value is in the max heap
+            if (!isNew && *pvalue < old) {
+                maxSortDown(p * 2);
+            } else if (maxSortUp(p)) {
+                minSortDown(1);
+            }
+        } else {
+            // new value is at median
+            if (maxCount()) {
+                maxSortDown(-1);
+            }
+            if (minCount()) {
+                minSortDown(1);
+            }
+        }
+        *pvalue = window[heap(0)];
+        return true;
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        count = 0;
+        index = 0;
+        // initial fill pattern of the heap: median, max, min, max, min, ...
+        for (int i = N - 1; i >= 0; i--) {
+            pos[i] = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+            heap(pos[i]) = i;
+        }
+    }
+
+  private:
+    int &heap(int i) {
+        // heap positions run from -N/2 (max heap) over 0 (median) to (N-1)/2 (min heap)
+        return heapIdx[i + (int)N / 2];
+    }
+    int minCount() {
+        return ((int)count - 1) / 2;
+    }
+    int maxCount() {
+        return (int)count / 2;
+    }
+    bool less(int i, int j) {
+        return window[heap(i)] < window[heap(j)];
+    }
+    bool exchange(int i, int j) {
+        int t = heap(i);
+        heap(i) = heap(j);
+        heap(j) = t;
+        pos[heap(i)] = i;
+        pos[heap(j)] = j;
+        return true;
+    }
+    bool cmpExchange(int i, int j) {
+        return less(i, j) && exchange(i, j);
+    }
+    void minSortDown(int i) {
+        for (; i <= minCount(); i *= 2) {
+            if (i > 1 && i < minCount() && less(i + 1, i)) {
+                ++i;
+            }
+            if (!cmpExchange(i, i / 2)) {
+                break;
+            }
+        }
+    }
+    void maxSortDown(int i) {
+        for (; i >= -maxCount(); i *= 2) {
+            if (i < -1 && i > -maxCount() && less(i, i - 1)) {
+                --i;
+            }
+            if (!cmpExchange(i / 2, i)) {
+                break;
+            }
+        }
+    }
+    bool minSortUp(int i) {
+        while (i > 0 && cmpExchange(i, i / 2)) {
+            i /= 2;
+        }
+        return i == 0;
+    }
+    bool maxSortUp(int i) {
+        while (i < 0 && cmpExchange(i / 2, i)) {
+            i /= 2;
+        }
+        return i == 0;
+    }
+};
+
+/*!  \brief muwerk kalmanFilter class
+
+Filter engine (see \ref exponentialFilter for the interface) implementing a scalar (1-D)
+Kalman filter for a value that is assumed to be constant apart from a random walk with
+variance processNoise per sample, measured with a sensor of variance measurementNoise.
+The ratio of both values determines the smoothing: a small processNoise compared to
+measurementNoise results in strong smoothing and slower response to change.
+*/
+template <typename T_FLOAT = double> class kalmanFilter {
+  public:
+    T_FLOAT processNoise;
+    T_FLOAT measurementNoise;
+    T_FLOAT estimate = 0;
+    T_FLOAT errorCovariance;
+    bool first = true;
+
+    kalmanFilter(T_FLOAT processNoise = 0.01, T_FLOAT measurementNoise = 1.0)
+        : processNoise{processNoise}, measurementNoise{measurementNoise} {
+        /*! Creates a new kalmanFilter
+        @param processNoise Variance of the change of the true value per sample
+        @param measurementNoise Variance of the sensor readings
+        */
+        reset();
+    }
+
+    bool filter(T_FLOAT *pvalue) {
+        /*! Feed a raw value into the filter
+        @param *pvalue raw value, replaced by the new estimate.
+        @return always true
+        */
+        if (first) {
+            first = false;
+            estimate = *pvalue;
+        } else {
+            errorCovariance += processNoise;
+            T_FLOAT gain = errorCovariance / (errorCovariance + measurementNoise);
+            estimate += gain * (*pvalue - estimate);
+            errorCovariance *= (T_FLOAT)1 - gain;
+        }
+        *pvalue = estimate;
+        return true;
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        first = true;
+        estimate = 0;
+        errorCovariance = measurementNoise;
+    }
+};
+
+/*!  \brief muwerk sensorfilter class
+
+sensorfilter combines an arbitrary filter engine with the throttling rules of
+\ref sensorprocessor: a new reading is generated, if the filtered value changed more than
+eps, or if pollTimeSec seconds have passed since the last reading.
+
+The filter engine is selected at compile time by the template parameter T_ENGINE, so there
+are no virtual calls in the filter path. Available engines are \ref exponentialFilter,
+\ref movingAverageFilter, \ref medianFilter and \ref kalmanFilter. The engine instance is
+accessible as member `engine`.
+
+Example:
+
+~~~{.cpp}
+// median over the last 7 values, new reading on change > 0.1 or every 3600sec
+ustd::sensorfilter<ustd::medianFilter<7>> spikySensor(3600, 0.1);
+// Kalman filter with custom noise parameters
+ustd::sensorfilter<ustd::kalmanFilter<float>, float> noisySensor(
+    ustd::kalmanFilter<float>(0.001, 4.0), 600, 0.5);
+
+void loop() {
+    double value=ReadMySpikySensor();
+    if (spikySensor.filter(&value)) {
+        printf("We got a new, filtered reading: %f\n", value);
+    }
+}
+~~~
+*/
+template <typename T_ENGINE, typename T_FLOAT = double> class sensorfilter {
+  public:
+    T_ENGINE engine;
+    unsigned int pollTimeSec;
+    T_FLOAT eps;
+    bool first = true;
+    T_FLOAT lastVal = (T_FLOAT)SENSOR_VALUE_INVALID;
+    unsigned long last;
+
+    sensorfilter(unsigned int pollTimeSec = 60, T_FLOAT eps = 0.1)
+        : pollTimeSec{pollTimeSec}, eps{eps} {
+        /*! Creates a new sensorfilter with a default constructed engine
+        @param pollTimeSec If this is !=0, a valid sensor reading is generated
+        at least every pollTimeSec, regardless of value changes.
+        @param eps The minimal change required for the filtered sensor value in
+        order to create a new valid reading.
+        */
+        reset();
+    }
+
+    sensorfilter(const T_ENGINE &engine, unsigned int pollTimeSec = 60, T_FLOAT eps = 0.1)
+        : engine{engine}, pollTimeSec{pollTimeSec}, eps{eps} {
+        /*! Creates a new sensorfilter with a preconfigured engine
+        @param engine Filter engine instance that will be copied
+        @param pollTimeSec If this is !=0, a valid sensor reading is generated
+        at least every pollTimeSec, regardless of value changes.
+        @param eps The minimal change required for the filtered sensor value in
+        order to create a new valid reading.
+        */
+        reset();
+    }
+
+    bool filter(T_FLOAT *pvalue) {
+        /*! The sensorfilter filter function.
+        @param *pvalue the current raw sensor reading. If a valid new value is
+        available, *pvalue is changed to the filtered value.
+        @return on true, *pvalue contains a new, filtered valid sensor reading.
+        */
+        T_FLOAT value = *pvalue;
+        if (!engine.filter(&value)) {
+            return false;
+        }
+        T_FLOAT delta = lastVal - value;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        if (delta > eps || first ||
+            (pollTimeSec != 0 && timeDiff(last, millis()) > pollTimeSec * 1000L)) {
+            first = false;
+            lastVal = value;
+            *pvalue = value;
+            last = millis();
+            return true;
+        }
+        return false;
+    }
+
+    bool filter(long *plvalue) {
+        /*! The sensorfilter filter function. (long integer version)
+        @param *plvalue the current raw sensor reading. If a valid new value is
+        available, *plvalue is changed to the filtered value.
+        @return on true, *plvalue contains a new, filtered valid sensor reading.
+        */
+        T_FLOAT tval = (T_FLOAT)*plvalue;
+        bool ret = filter(&tval);
+        if (ret) {
+            *plvalue = (long)tval;
+        }
+        return ret;
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        engine.reset();
+        first = true;
+        lastVal = (T_FLOAT)SENSOR_VALUE_INVALID;
+        last = millis();
+    }
+};
+
+/*!  \brief muwerk numericFunction class
+ *
+ * numericFunktion approximates arbitrary values x of a function f(x) defined
+ * by a number points (x,y) using linear approximation to nearest neighbour-points.
+ *
+ * By default, the interval containing x is located by binary search. For functions that
+ * are evaluated very often, \ref compileGrid() precomputes a uniform grid that reduces each
+ * evaluation to an index computation and a multiply-add.
+ *
+ * Example:
+
+~~~{.cpp}
+    // Define a numeric function for (0,9), (1,3), (2,2.8), (3,1)
+    const float cx[] = {0., 1., 2., 3.}, cy[] = {9, 3, 2.8, 1};
+    // generate model, extrapolate for x outside of (0...3)
+    ustd::numericFunction<float> f(cx, cy, sizeof(cx) / sizeof(float), true);
+
+    for (float x = -1.0; x < 5.0; x+=0.1) {
+        printf("%f->%f\n", x, f(x));
+    }
+
+    // generates:
+    ...
+    -0.300000 -> 10.800000
+    -0.200000 -> 10.200000
+    -0.100000 -> 9.600000
+    0.000000 -> 9.000000
+    0.100000 -> 8.400000
+    0.200000 -> 7.800000
+    0.300000 -> 7.200000
+    ...
+    0.800000 -> 4.200000
+    0.900000 -> 3.600000
+    1.000000 -> 3.000000
+    1.100000 -> 2.980000
+    1.200000 -> 2.960000
+    1.300000 -> 2.940000
+    ...
+    1.800000 -> 2.840000
+    1.900000 -> 2.820000
+    2.000000 -> 2.800000
+    2.100000 -> 2.620000
+    2.200000 -> 2.440000
+    ...
+    2.800000 -> 1.360000
+    2.900000 -> 1.180000
+    3.000000 -> 1.000000
+    3.100000 -> 0.940000
+    3.200000 -> 0.880000
+    ...
+~~~
+*/
+template <typename T_FLOAT> class numericFunction {
+  public:
+    ustd::array<T_FLOAT> x, y;
+    T_FLOAT minX, minY, maxX, maxY;
+    unsigned int len;
+    bool dir;
+    bool extrapolate;
+    ustd::array<T_FLOAT> gridOffset, gridSlope;
+    unsigned int gridLen = 0;
+    unsigned int gridResolution = 0;
+    T_FLOAT gridInvStep = 0;
+    T_FLOAT gridError = 0;
+    ustd::array<T_FLOAT> splineC1, splineC2, splineC3;
+    bool spline = false;
+    numericFunction(const T_FLOAT px[], const T_FLOAT py[], unsigned int count,
+                    bool _extrapolate = false, bool _spline = false) {
+        /*! Instatiate a numericFunction with point px and py.
+
+        @param px array of length count of x-values.
+        @param py corresponding array of y-values, f(px[i])=py[i]
+        @param count array member count of both px and py
+        @param _extrapolate false: if px is ouside of the defined points, x<min(px) gives py[0],
+                            x>max(px) gives py[count-1], on true linear approximation is used.
+        @param _spline false: linear interpolation between points, true: monotone cubic
+                       interpolation, see \ref compileSpline().
+        */
+
+        extrapolate = _extrapolate;
+        len = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            if (i > 0) {
+                // enforce strict monotony:
+                if (px[i] <= x[len - 1])
+                    continue;
+                if (py[i] == y[len - 1])
+                    continue;
+
+                if (len == 1)
+                    dir = (py[i] > y[len - 1]);
+                if ((py[i] > y[len - 1]) != dir)
+                    continue;
+            }
+            x[len] = px[i];
+            y[len] = py[i];
+            if (i == 0 || minX > x[len])
+                minX = x[len];
+            if (i == 0 || minY > y[len])
+                minY = y[len];
+            if (i == 0 || maxX < x[len])
+                maxX = x[len];
+            if (i == 0 || maxY < y[len])
+                maxY = y[len];
+            ++len;
+        }
+        if (_spline)
+            compileSpline();
+    }
+
+    static T_FLOAT min(const ustd::array<T_FLOAT> &ar) {
+        /*! get minimum value of array ar
+        @param ar ustd::array
+        */
+        return minOf(ar, ar.length());
+    }
+
+    static T_FLOAT min(const T_FLOAT *ar, unsigned int count) {
+        /*! get minimum value of caller-owned array ar
+        @param ar array of T_FLOAT
+        @param count number of elements in ar
+        */
+        return minOf(ar, count);
+    }
+
+    static T_FLOAT max(const ustd::array<T_FLOAT> &ar) {
+        /*! get maximum value of array ar
+        @param ar ustd::array
+        */
+        return maxOf(ar, ar.length());
+    }
+
+    static T_FLOAT max(const T_FLOAT *ar, unsigned int count) {
+        /*! get maximum value of caller-owned array ar
+        @param ar array of T_FLOAT
+        @param count number of elements in ar
+        */
+        return maxOf(ar, count);
+    }
+
+    static void rescale(ustd::array<T_FLOAT> *par, T_FLOAT *pminX, T_FLOAT *pmaxX, T_FLOAT newMin,
+                        T_FLOAT newMax) {
+        /*! inplace rescale an array so that it conforms to newMin and newMax
+
+        Note: current minimum and maximum must be given to pminX and pmaxX (see \ref min(), \ref
+        max() ).
+
+        @param par point to ustd::array to be rescaled
+        @param pminX pointer to mimimum value of array-members in ar, will be overwriten with new
+        actual minimum.
+        @param pmaxX pointer to maximum value of array-members in ar, will be overwriten with new
+        actual maximum.
+        @param newMin The entire array ar is transformed linearily so that the new minimum is newMin
+        @param newMax The entire array ar is transformed linearily so that the new maximum is
+        newMax.
+        */
+        rescaleOf(*par, (*par).length(), pminX, pmaxX, newMin, newMax);
+    }
+
+    static void rescale(T_FLOAT *ar, unsigned int count, T_FLOAT *pminX, T_FLOAT *pmaxX,
+                        T_FLOAT newMin, T_FLOAT newMax) {
+        /*! inplace rescale a caller-owned array so that it conforms to newMin and newMax
+
+        Note: current minimum and maximum must be given to pminX and pmaxX (see \ref min(), \ref
+        max() ).
+
+        @param ar array of T_FLOAT to be rescaled
+        @param count number of elements in ar
+        @param pminX pointer to mimimum value of array-members in ar, will be overwriten with new
+        actual minimum.
+        @param pmaxX pointer to maximum value of array-members in ar, will be overwriten with new
+        actual maximum.
+        @param newMin The entire array ar is transformed linearily so that the new minimum is newMin
+        @param newMax The entire array ar is transformed linearily so that the new maximum is
+        newMax.
+        */
+        rescaleOf(ar, count, pminX, pmaxX, newMin, newMax);
+    }
+
+    void rescaleX(T_FLOAT newMin, T_FLOAT newMax) {
+        /*! Rescale x-axis linearily
+
+        @param newMin new start of x-values
+        @param newMax new end of x-values
+        */
+        rescale(&x, &minX, &maxX, newMin, newMax);
+        if (spline)
+            compileSpline();
+        if (gridLen)
+            compileGrid(gridResolution);
+    }
+    void rescaleY(T_FLOAT newMin, T_FLOAT newMax) {
         /*! Rescale y-axis linearily
 
         @param newMin new start of y-values
         @param newMax new end of y-values
         */
         rescale(&y, &minY, &maxY, newMin, newMax);
+        if (spline)
+            compileSpline();
+        if (gridLen)
+            compileGrid(gridResolution);
     }
 
     static int linsearch(ustd::array<T_FLOAT> &ar, T_FLOAT x) {
@@ -385,14 +1510,256 @@ template <typename T_FLOAT> class numericFunction {
                 return y[len - 1] + dy / dx1 * dx2;
             }
         }
+        if (gridLen)
+            return gridInterpol(xi);
+        return exactInterpol(xi);
+    }
+
+    T_FLOAT exactInterpol(T_FLOAT xi) {
+        /*! Get interpolated value at point f(xi) without using the grid
+
+        Uses \ref splineInterpol() if the spline mode is active, \ref searchInterpol()
+        otherwise. Note: xi must be within minX and maxX, see \ref interpol() for the
+        general case.
+
+        @param xi Value of x used to interpole f(x)
+        */
+        if (spline)
+            return splineInterpol(xi);
+        return searchInterpol(xi);
+    }
+
+    bool compileSpline() {
+        /*! Switch to monotone cubic interpolation between the points
+
+        Between the points, the function is approximated by cubic Hermite polynomials with
+        tangents chosen according to Fritsch-Carlson, so that the interpolation is smooth
+        and preserves the monotony of the points (no overshoot). Compared to linear
+        interpolation, the same accuracy for smooth curves is achieved with far fewer
+        points. The polynomial coefficients are precomputed once (three values of T_FLOAT
+        per point), evaluation costs a binary search and three multiply-adds, or
+        O(1) if combined with \ref compileGrid().
+
+        Note: extrapolation outside of minX and maxX remains linear.
+
+        @return true on success, false if the function has less than two points
+        or memory could not be allocated.
+        */
+        spline = false;
+        if (len < 2)
+            return false;
+        if (!splineC1.resize(len) || !splineC2.resize(len) || !splineC3.resize(len))
+            return false;
+        // secants, temporarily stored in splineC3
+        for (unsigned int i = 0; i < len - 1; i++) {
+            splineC3[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+        }
+        // initial tangents (three point estimates), stored in splineC1
+        if (len == 2) {
+            splineC1[0] = splineC3[0];
+            splineC1[1] = splineC3[0];
+        } else {
+            splineC1[0] = endTangent(x[1] - x[0], x[2] - x[1], splineC3[0], splineC3[1]);
+            splineC1[len - 1] = endTangent(x[len - 1] - x[len - 2], x[len - 2] - x[len - 3],
+                                           splineC3[len - 2], splineC3[len - 3]);
+        }
+        for (unsigned int i = 1; i < len - 1; i++) {
+            T_FLOAT h0 = x[i] - x[i - 1], h1 = x[i + 1] - x[i];
+            splineC1[i] = (h1 * splineC3[i - 1] + h0 * splineC3[i]) / (h0 + h1);
+        }
+        // Fritsch-Carlson: limit tangents to 3 times the secant to preserve monotony
+        for (unsigned int i = 0; i < len - 1; i++) {
+            T_FLOAT limit = 3 * splineC3[i];
+            if (splineC1[i] / splineC3[i] > 3)
+                splineC1[i] = limit;
+            if (splineC1[i + 1] / splineC3[i] > 3)
+                splineC1[i + 1] = limit;
+        }
+        // polynomial coefficients: y = y[i] + t * (c1 + t * (c2 + t * c3)), t = xi - x[i]
+        for (unsigned int i = 0; i < len - 1; i++) {
+            T_FLOAT h = x[i + 1] - x[i];
+            T_FLOAT secant = splineC3[i];
+            splineC2[i] = (3 * secant - 2 * splineC1[i] - splineC1[i + 1]) / h;
+            splineC3[i] = (splineC1[i] + splineC1[i + 1] - 2 * secant) / (h * h);
+        }
+        spline = true;
+        if (gridLen)
+            compileGrid(gridResolution);
+        return true;
+    }
+
+    T_FLOAT splineInterpol(T_FLOAT xi) {
+        /*! Get monotone cubic interpolated value at point f(xi)
+
+        Note: requires \ref compileSpline(), xi must be within minX and maxX, see
+        \ref interpol() for the general case.
+
+        @param xi Value of x used to interpole f(x)
+        */
+        unsigned int n = linsearch(x, xi);
+        if (n >= len - 1)
+            return y[len - 1];
+        return splineSegment(n, xi);
+    }
+
+    T_FLOAT searchInterpol(T_FLOAT xi) {
+        /*! Get interpolated value at point f(xi) using binary search over the points
+
+        Note: xi must be within minX and maxX, see \ref interpol() for the general case.
+
+        @param xi Value of x used to interpole f(x)
+        */
         unsigned int n = linsearch(x, xi);
         if (n >= len - 1)
             return y[len - 1];
-        dx1 = x[n] - x[n + 1];
-        dx2 = xi - x[n];
-        dy = y[n + 1] - y[n];
-        float yi = y[n] - dy / dx1 * dx2;
-        return yi;
+        return linearSegment(n, xi);
+    }
+
+    void evaluate(const T_FLOAT *xs, T_FLOAT *ys, size_t n) {
+        /*! Evaluate f(x) for a buffer of values
+
+        Gives the same results as calling \ref interpol() for each value, but faster for
+        larger buffers. The large speedup applies to input sorted in ascending order: the
+        intervals are located by a single sweep over the points instead of one binary search
+        per value. Unsorted input still needs a binary search per value, the searches of
+        blocks of values are interleaved and branch free, which gains a factor of about two
+        to four. With an active grid (see \ref compileGrid()), each value is evaluated in
+        O(1) anyway.
+
+        @param xs array of n x-values
+        @param ys array that receives the n values f(xs[i]), may be identical to xs.
+        @param n number of values
+        */
+        if (len < 2 || gridLen) {
+            for (size_t i = 0; i < n; i++) {
+                ys[i] = interpol(xs[i]);
+            }
+            return;
+        }
+        for (size_t i = 1; i < n; i++) {
+            if (xs[i] < xs[i - 1]) {
+                evaluateUnsorted(xs, ys, n);
+                return;
+            }
+        }
+        // coefficients of the current segment, reloaded only if the segment changes
+        unsigned int seg = 0, loaded = len;
+        T_FLOAT x0 = 0, x1 = x[1], y0 = 0, c1 = 0, c2 = 0, c3 = 0;
+        for (size_t i = 0; i < n; i++) {
+            T_FLOAT xi = xs[i];
+            if (xi < minX || xi > maxX) {
+                ys[i] = interpol(xi);
+                continue;
+            }
+            while (x1 <= xi && seg < len - 2) {
+                ++seg;
+                x1 = x[seg + 1];
+            }
+            if (seg != loaded) {
+                loaded = seg;
+                x0 = x[seg];
+                y0 = y[seg];
+                if (spline) {
+                    c1 = splineC1[seg];
+                    c2 = splineC2[seg];
+                    c3 = splineC3[seg];
+                } else {
+                    // same operation order as linearSegment() for identical results
+                    c1 = (y[seg + 1] - y0) / (x0 - x[seg + 1]);
+                }
+            }
+            T_FLOAT t = xi - x0;
+            ys[i] = spline ? y0 + t * (c1 + t * (c2 + t * c3)) : y0 - c1 * t;
+        }
+    }
+
+    bool compileGrid(unsigned int resolution = 0) {
+        /*! Precompile the function onto a uniform grid for O(1) lookup
+
+        The function is resampled onto `resolution` equally sized intervals between minX
+        and maxX, and slope and offset of each interval are precomputed. After that,
+        \ref interpol() evaluates f(x) with an index computation and a single multiply-add
+        instead of a binary search and a division. Values outside of minX and maxX are handled
+        as before.
+
+        If the points of the function are not uniformly spaced, resampling introduces an
+        approximation error at the original points. The maximum of that error is
+        returned in gridError. In spline mode (see \ref compileSpline()), the grid
+        approximates the spline linearily and gridError also includes the deviation
+        at the centers of the grid intervals. A finer grid reduces the error at the cost of
+        memory (two values of T_FLOAT per interval).
+
+        Note: \ref rescaleX() and \ref rescaleY() recompile an active grid.
+
+        @param resolution Number of grid intervals. If 0 (default), the original points are
+        used directly if they are uniformly spaced (gridError is 0), otherwise 8 grid
+        intervals per original interval are used.
+        @return true on success, false if the function has less than two points or
+        the grid could not be allocated. On failure the grid is disabled.
+        */
+        clearGrid();
+        if (len < 2)
+            return false;
+        unsigned int n = resolution;
+        if (n == 0) {
+            n = len - 1;
+            T_FLOAT step = (maxX - minX) / n;
+            for (unsigned int i = 0; i < len; i++) {
+                T_FLOAT d = x[i] - (minX + step * i);
+                if (d > step / 1000 || d < -step / 1000) {
+                    n = 8 * (len - 1);
+                    break;
+                }
+            }
+        }
+        if (!gridOffset.resize(n) || !gridSlope.resize(n))
+            return false;
+        T_FLOAT step = (maxX - minX) / n;
+        T_FLOAT x0 = minX, y0 = y[0];
+        for (unsigned int i = 0; i < n; i++) {
+            T_FLOAT x1 = (i == n - 1) ? maxX : minX + step * (i + 1);
+            T_FLOAT y1 = (i == n - 1) ? y[len - 1] : exactInterpol(x1);
+            gridSlope[i] = (y1 - y0) / (x1 - x0);
+            gridOffset[i] = y0 - gridSlope[i] * x0;
+            x0 = x1;
+            y0 = y1;
+        }
+        gridLen = n;
+        gridResolution = resolution;
+        gridInvStep = (T_FLOAT)n / (maxX - minX);
+        gridError = 0;
+        for (unsigned int i = 0; i < len; i++) {
+            updateGridError(x[i], y[i]);
+        }
+        if (spline) {
+            // the cubic segments deviate most between the grid points
+            for (unsigned int i = 0; i < n; i++) {
+                T_FLOAT xm = minX + step * i + step / 2;
+                updateGridError(xm, splineInterpol(xm));
+            }
+        }
+        return true;
+    }
+
+    void clearGrid() {
+        /*! Disable a grid created by \ref compileGrid() */
+        gridOffset.erase();
+        gridSlope.erase();
+        gridLen = 0;
+        gridError = 0;
+    }
+
+    T_FLOAT gridInterpol(T_FLOAT xi) {
+        /*! Get interpolated value at point f(xi) using the grid created by \ref compileGrid()
+
+        Note: xi must be within minX and maxX, see \ref interpol() for the general case.
+
+        @param xi Value of x used to interpole f(x)
+        */
+        unsigned int i = (unsigned int)((xi - minX) * gridInvStep);
+        if (i >= gridLen)
+            i = gridLen - 1;
+        return gridOffset[i] + gridSlope[i] * xi;
     }
 
     T_FLOAT operator()(T_FLOAT x) {
@@ -401,6 +1768,366 @@ template <typename T_FLOAT> class numericFunction {
         */
         return interpol(x);
     }
+
+  private:
+    template <typename T_ARRAY> static T_FLOAT minOf(T_ARRAY &ar, unsigned int count) {
+        T_FLOAT minVal = 0.0;
+        for (unsigned int i = 0; i < count; i++) {
+            if (i == 0 || ar[i] < minVal)
+                minVal = ar[i];
+        }
+        return minVal;
+    }
+
+    template <typename T_ARRAY> static T_FLOAT maxOf(T_ARRAY &ar, unsigned int count) {
+        T_FLOAT maxVal = 0.0;
+        for (unsigned int i = 0; i < count; i++) {
+            if (i == 0 || ar[i] > maxVal)
+                maxVal = ar[i];
+        }
+        return maxVal;
+    }
+
+    template <typename T_ARRAY>
+    static void rescaleOf(T_ARRAY &ar, unsigned int count, T_FLOAT *pminX, T_FLOAT *pmaxX,
+                          T_FLOAT newMin, T_FLOAT newMax) {
+        T_FLOAT dx;
+        T_FLOAT newMinX = newMin, newMaxX = newMax;
+        if (count < 2 || *pminX == *pmaxX)
+            dx = 1;
+        else
+            dx = (*pmaxX - *pminX);
+        T_FLOAT ndx = newMax - newMin;
+        for (unsigned int i = 0; i < count; i++) {
+            T_FLOAT xi = (ar[i] - *pminX) / dx * ndx + newMin;
+            ar[i] = xi;
+            if (i == 0 || newMinX > xi)
+                newMinX = xi;
+            if (i == 0 || newMaxX < xi)
+                newMaxX = xi;
+        }
+        *pminX = newMinX;
+        *pmaxX = newMaxX;
+    }
+
+    void evaluateUnsorted(const T_FLOAT *xs, T_FLOAT *ys, size_t n) {
+        // the binary searches of a block of values are interleaved step by step: the lookups
+        // are independent, so that their memory accesses and comparisons overlap
+        const unsigned int block = 8;
+        unsigned int seg[block];
+        T_FLOAT xb[block];
+        for (size_t i = 0; i < n; i += block) {
+            unsigned int m = n - i < block ? n - i : block;
+            for (unsigned int k = 0; k < block; k++) {
+                seg[k] = 0;
+                xb[k] = k < m ? xs[i + k] : minX;
+            }
+            for (unsigned int count = len - 1; count > 1;) {
+                unsigned int half = count / 2;
+                for (unsigned int k = 0; k < block; k++) {
+                    seg[k] = (x[seg[k] + half] <= xb[k]) ? seg[k] + half : seg[k];
+                }
+                count -= half;
+            }
+            for (unsigned int k = 0; k < m; k++) {
+                if (xb[k] < minX || xb[k] > maxX) {
+                    ys[i + k] = interpol(xb[k]);
+                } else {
+                    ys[i + k] =
+                        spline ? splineSegment(seg[k], xb[k]) : linearSegment(seg[k], xb[k]);
+                }
+            }
+        }
+    }
+
+    T_FLOAT linearSegment(unsigned int n, T_FLOAT xi) {
+        T_FLOAT dx1 = x[n] - x[n + 1];
+        T_FLOAT dx2 = xi - x[n];
+        T_FLOAT dy = y[n + 1] - y[n];
+        return y[n] - dy / dx1 * dx2;
+    }
+
+    T_FLOAT splineSegment(unsigned int n, T_FLOAT xi) {
+        T_FLOAT t = xi - x[n];
+        return y[n] + t * (splineC1[n] + t * (splineC2[n] + t * splineC3[n]));
+    }
+
+    static T_FLOAT endTangent(T_FLOAT h0, T_FLOAT h1, T_FLOAT secant0, T_FLOAT secant1) {
+        // non-centered three point estimate of the tangent at an end point
+        T_FLOAT m = ((2 * h0 + h1) * secant0 - h0 * secant1) / (h0 + h1);
+        if ((m > 0) != (secant0 > 0))
+            return 0;
+        return m;
+    }
+
+    void updateGridError(T_FLOAT xi, T_FLOAT yi) {
+        T_FLOAT err = gridInterpol(xi) - yi;
+        if (err < 0)
+            err = -err;
+        if (err > gridError)
+            gridError = err;
+    }
+};
+
+/*!  \brief muwerk constNumericFunction class
+ *
+ * constNumericFunction provides the same linear approximation as \ref numericFunction, but
+ * works directly on constant tables instead of copying the points into RAM. On AVR platforms
+ * the tables can be placed in flash memory using `PROGMEM`, elsewhere they are plain
+ * `constexpr` arrays. An instance only holds two pointers, the point count and the
+ * extrapolation flag.
+ *
+ * Since the tables are not copied, points violating strict monotony can not be removed like
+ * numericFunction does. Instead, the function is limited to the longest strictly monotone
+ * prefix of the tables. Use \ref isMonotone() in a `static_assert` to verify the tables at
+ * compile time. Minimum and maximum of both axes are taken from the end points of the
+ * tables. Except on AVR, where the tables are read from flash memory, they are compile time
+ * constants for `constexpr` instances.
+ *
+ * Note: on AVR, the constructor can not read `PROGMEM` tables, so the full count is used and
+ * the tables must be verified with `static_assert`. Set the template parameter FLASH to false
+ * for tables in RAM.
+ *
+ * Example:
+
+~~~{.cpp}
+    // Define a numeric function for (0,9), (1,3), (2,2.8), (3,1) in flash memory
+    constexpr float cx[] PROGMEM = {0., 1., 2., 3.}, cy[] PROGMEM = {9, 3, 2.8, 1};
+    static_assert(ustd::constNumericFunction<float>::isMonotone(cx, cy, 4), "Invalid table");
+
+    constexpr ustd::constNumericFunction<float> f(cx, cy, 4, true);
+
+    float y = f(1.5);  // 2.9
+~~~
+*/
+#ifdef __AVR__
+#define CONSTNUMERIC_CONSTEXPR
+#else
+#define CONSTNUMERIC_CONSTEXPR constexpr
+#endif
+template <typename T_FLOAT, bool FLASH = true> class constNumericFunction {
+  public:
+    const T_FLOAT *px;
+    const T_FLOAT *py;
+    unsigned int len;
+    bool extrapolate;
+
+    constexpr constNumericFunction(const T_FLOAT px[], const T_FLOAT py[], unsigned int count,
+                                   bool _extrapolate = false)
+#ifdef __AVR__
+        : px{px}, py{py}, len{FLASH ? count : validLength(px, py, count)},
+          extrapolate{_extrapolate} {
+#else
+        : px{px}, py{py}, len{validLength(px, py, count)}, extrapolate{_extrapolate} {
+#endif
+        /*! Instatiate a constNumericFunction referencing the points px and py.
+
+        @param px constant array of length count of x-values, strictly monotone rising.
+        @param py corresponding constant array of y-values, f(px[i])=py[i], strictly monotone.
+        @param count array member count of both px and py
+        @param _extrapolate false: if px is ouside of the defined points, x<min(px) gives py[0],
+                            x>max(px) gives py[count-1], on true linear approximation is used.
+        */
+    }
+
+    static constexpr unsigned int validLength(const T_FLOAT px[], const T_FLOAT py[],
+                                              unsigned int count) {
+        /*! Get the length of the longest prefix of the tables that is strictly monotone
+
+        x-values must be strictly rising, y-values strictly rising or falling.
+
+        @param px array of length count of x-values
+        @param py corresponding array of y-values
+        @param count array member count of both px and py
+        @return number of valid points
+        */
+        return count < 2 ? count : firstInvalid(px, py, 1, count, py[1] > py[0]);
+    }
+
+    static constexpr bool isMonotone(const T_FLOAT px[], const T_FLOAT py[], unsigned int count) {
+        /*! Check if the tables are strictly monotone (usable in `static_assert`)
+        @param px array of length count of x-values
+        @param py corresponding array of y-values
+        @param count array member count of both px and py
+        @return true, if all points are valid
+        */
+        return validLength(px, py, count) == count;
+    }
+
+    CONSTNUMERIC_CONSTEXPR T_FLOAT x(unsigned int i) const {
+        /*! Get x-value of point i (from flash memory on AVR)
+        @param i point index
+        */
+        return read(&px[i]);
+    }
+
+    CONSTNUMERIC_CONSTEXPR T_FLOAT y(unsigned int i) const {
+        /*! Get y-value of point i (from flash memory on AVR)
+        @param i point index
+        */
+        return read(&py[i]);
+    }
+
+    CONSTNUMERIC_CONSTEXPR T_FLOAT minX() const {
+        //! Get minimum x-value
+        return len ? x(0) : 0;
+    }
+    CONSTNUMERIC_CONSTEXPR T_FLOAT maxX() const {
+        //! Get maximum x-value
+        return len ? x(len - 1) : 0;
+    }
+    CONSTNUMERIC_CONSTEXPR T_FLOAT minY() const {
+        //! Get minimum y-value
+        return len ? (y(0) < y(len - 1) ? y(0) : y(len - 1)) : 0;
+    }
+    CONSTNUMERIC_CONSTEXPR T_FLOAT maxY() const {
+        //! Get maximum y-value
+        return len ? (y(0) > y(len - 1) ? y(0) : y(len - 1)) : 0;
+    }
+
+    unsigned int search(T_FLOAT xi) const {
+        /*! Get largest index of a point with an x-value smaller than xi using binary search.
+        @param xi value to be searched
+        */
+        int a = 0, b = len - 1, n;
+        while (b - a > 1) {
+            n = (a + b) / 2;
+            T_FLOAT xn = x(n);
+            if (xn == xi)
+                return n;
+            if (xi > xn)
+                a = n;
+            else
+                b = n;
+        }
+        return a;
+    }
+
+    T_FLOAT interpol(T_FLOAT xi) const {
+        /*! Get interpolated value at point f(xi)
+        @param xi Value of x used to interpole f(x)
+        */
+        if (len == 0)
+            return 0.0;
+        if (len == 1)
+            return y(0);
+        unsigned int n;
+        if (xi < x(0)) {
+            if (!extrapolate)
+                return y(0);
+            n = 0;
+        } else if (xi > x(len - 1)) {
+            if (!extrapolate)
+                return y(len - 1);
+            n = len - 2;
+        } else {
+            n = search(xi);
+            if (n >= len - 1)
+                return y(len - 1);
+        }
+        T_FLOAT x0 = x(n), y0 = y(n);
+        return y0 + (y(n + 1) - y0) / (x(n + 1) - x0) * (xi - x0);
+    }
+
+    T_FLOAT operator()(T_FLOAT xi) const {
+        /*! interpolate f(x), uses \ref interpol()
+        @param xi value to be approximated by f(x).
+        */
+        return interpol(xi);
+    }
+
+  private:
+    static constexpr bool validPoint(const T_FLOAT px[], const T_FLOAT py[], unsigned int i,
+                                     bool dir) {
+        return px[i] > px[i - 1] && py[i] != py[i - 1] && (py[i] > py[i - 1]) == dir;
+    }
+
+    static constexpr unsigned int firstInvalid(const T_FLOAT px[], const T_FLOAT py[],
+                                               unsigned int first, unsigned int last, bool dir) {
+        // C++11 constexpr allows no loops: split the range in halves, so that the recursion
+        // depth grows with log2(count) and large tables stay below the compiler's limit
+        return last - first == 1
+                   ? (validPoint(px, py, first, dir) ? last : first)
+                   : firstInvalidRight(px, py, firstInvalid(px, py, first, (first + last) / 2, dir),
+                                       (first + last) / 2, last, dir);
+    }
+
+    static constexpr unsigned int firstInvalidRight(const T_FLOAT px[], const T_FLOAT py[],
+                                                    unsigned int left, unsigned int mid,
+                                                    unsigned int last, bool dir) {
+        return left < mid ? left : firstInvalid(px, py, mid, last, dir);
+    }
+
+#ifdef __AVR__
+    static T_FLOAT read(const T_FLOAT *p) {
+        if (FLASH) {
+            T_FLOAT v;
+            memcpy_P(&v, p, sizeof(T_FLOAT));
+            return v;
+        }
+        return *p;
+    }
+#else
+    static constexpr T_FLOAT read(const T_FLOAT *p) {
+        return *p;
+    }
+#endif
+};
+#undef CONSTNUMERIC_CONSTEXPR
+
+/*!  \brief muwerk numericFunctionView class
+ *
+ * numericFunctionView is a \ref constNumericFunction over caller-owned, mutable tables in RAM.
+ * Like a span, it only references the tables and never copies or allocates. In addition to
+ * the read-only interface of constNumericFunction, the tables can be rescaled in place.
+ *
+ * Example:
+
+~~~{.cpp}
+    float cx[] = {0., 1., 2., 3.}, cy[] = {9, 3, 2.8, 1};
+    ustd::numericFunctionView<float> f(cx, cy, 4);
+
+    f.rescaleX(0.0, 300.0);  // modifies cx
+    float y = f(150.);  // 2.9
+~~~
+*/
+template <typename T_FLOAT>
+class numericFunctionView : public constNumericFunction<T_FLOAT, false> {
+  public:
+    T_FLOAT *vx;
+    T_FLOAT *vy;
+
+    numericFunctionView(T_FLOAT px[], T_FLOAT py[], unsigned int count, bool _extrapolate = false)
+        : constNumericFunction<T_FLOAT, false>(px, py, count, _extrapolate), vx{px}, vy{py} {
+        /*! Instatiate a numericFunctionView referencing the points px and py.
+
+        @param px array of length count of x-values, strictly monotone rising.
+        @param py corresponding array of y-values, f(px[i])=py[i], strictly monotone.
+        @param count array member count of both px and py
+        @param _extrapolate false: if px is ouside of the defined points, x<min(px) gives py[0],
+                            x>max(px) gives py[count-1], on true linear approximation is used.
+        */
+    }
+
+    void rescaleX(T_FLOAT newMin, T_FLOAT newMax) {
+        /*! Rescale x-axis linearily in place
+
+        @param newMin new start of x-values
+        @param newMax new end of x-values
+        */
+        T_FLOAT minVal = this->minX(), maxVal = this->maxX();
+        numericFunction<T_FLOAT>::rescale(vx, this->len, &minVal, &maxVal, newMin, newMax);
+    }
+
+    void rescaleY(T_FLOAT newMin, T_FLOAT newMax) {
+        /*! Rescale y-axis linearily in place
+
+        @param newMin new start of y-values
+        @param newMax new end of y-values
+        */
+        T_FLOAT minVal = this->minY(), maxVal = this->maxY();
+        numericFunction<T_FLOAT>::rescale(vy, this->len, &minVal, &maxVal, newMin, newMax);
+    }
 };
 
 }  // namespace ustd
@@ -0,0 +1,575 @@
+// spectrum.h - muwerk spectral feature extraction
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "ustd_array.h"
+#include "scheduler.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace ustd {
+
+/*!  \brief muwerk goertzel class
+
+goertzel computes the amplitude of a single frequency of a signal with the
+    * Goertzel algorithm. It needs one multiplication per sample and no buffer, so
+    * it is the method of choice if only a few frequencies are of interest.
+    *
+    * Example:
+
+~~~{.cpp}
+ustd::goertzel<> hum(50.0, 1000.0);  // 50 Hz at 1 kHz sample rate
+
+void sample(float value) {
+    hum.add(value);
+    if (hum.count() == 200) {
+        printf("50 Hz amplitude: %f\n", hum.amplitude());
+        hum.reset();
+    }
+}
+~~~
+*/
+template <typename T_FLOAT = float> class goertzel {
+  private:
+    T_FLOAT coeff;
+    T_FLOAT s1, s2;
+    unsigned int n;
+
+  public:
+    T_FLOAT frequency;  //!< Frequency in Hz
+
+    goertzel(T_FLOAT frequency = 0, T_FLOAT sampleRate = 1) : frequency(frequency) {
+        /*! Creates a Goertzel filter
+        @param frequency Frequency to detect in Hz
+        @param sampleRate Sample rate in Hz
+        */
+        coeff = (T_FLOAT)(2.0 * cos(2.0 * M_PI * frequency / sampleRate));
+        reset();
+    }
+
+    void reset() {
+        /*! Delete the filter history */
+        s1 = s2 = 0;
+        n = 0;
+    }
+
+    void add(T_FLOAT sample) {
+        /*! Process a sample
+        @param sample The sample value
+        */
+        T_FLOAT s0 = sample + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+        ++n;
+    }
+
+    unsigned int count() const {
+        /*! Number of samples processed since the last reset
+        @return Number of samples
+        */
+        return n;
+    }
+
+    T_FLOAT power() const {
+        /*! Squared magnitude of the frequency component
+        @return Squared magnitude, not normalized
+        */
+        return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    }
+
+    T_FLOAT amplitude() const {
+        /*! Amplitude of the frequency component
+        @return Amplitude of a sine wave at the filter frequency in the processed samples
+        */
+        T_FLOAT p = power();
+        return n && p > 0 ? (T_FLOAT)(2.0 * sqrt(p) / n) : 0;
+    }
+};
+
+/*!  \brief muwerk realFFT class
+
+realFFT computes the power spectrum of N real samples (N a power of two, 8 to
+    * 1024) with a radix-2 FFT of N/2 complex points and a final split step. All
+    * buffers are allocated statically: N values for the data and N/4 + 1 values
+    * for a quarter wave sine table.
+    *
+    * The computation can be performed at once with \ref compute or incrementally
+    * with \ref step: each call processes at most a given number of butterflies
+    * (or samples in the window, bit reversal and split phases), so that a
+    * scheduler task never blocks for long.
+    *
+    * After the computation, \ref power returns the power of the frequency bins
+    * 0 .. N/2, bin k corresponds to the frequency k * sampleRate / N.
+*/
+template <unsigned int N = 256, typename T_FLOAT = float> class realFFT {
+    static_assert(N >= 8 && N <= 1024 && (N & (N - 1)) == 0,
+                  "realFFT size must be a power of two between 8 and 1024");
+
+  public:
+    enum Phase { IDLE, WINDOW, BITREV, BUTTERFLY, SPLIT, DONE };
+
+  private:
+    static const unsigned int M = N / 2;  // number of complex points
+    T_FLOAT buf[N];
+    T_FLOAT sinTab[N / 4 + 1];
+    Phase phase = IDLE;
+    bool windowed = true;
+    unsigned int index = 0;
+    unsigned int len = 2;
+
+  public:
+    realFFT() {
+        /*! Creates a realFFT of size N */
+        for (unsigned int i = 0; i <= N / 4; i++) {
+            sinTab[i] = (T_FLOAT)sin(2.0 * M_PI * i / N);
+        }
+    }
+
+    T_FLOAT *data() {
+        /*! Access the data buffer
+        @return Pointer to the N input samples, after the computation the buffer contains the
+        power spectrum (use \ref power to access it).
+        */
+        return buf;
+    }
+
+    void start(bool hannWindow = true) {
+        /*! Start a new computation on the samples in the data buffer
+        @param hannWindow (optional, default true) Apply a Hann window to the samples to reduce
+        spectral leakage.
+        */
+        windowed = hannWindow;
+        phase = hannWindow ? WINDOW : BITREV;
+        index = 0;
+        len = 2;
+    }
+
+    bool busy() const {
+        /*! Check if a computation is in progress
+        @return true, if a computation has been started and is not yet finished
+        */
+        return phase != IDLE && phase != DONE;
+    }
+
+    bool done() const {
+        /*! Check if a power spectrum is available
+        @return true, if the last computation has been finished
+        */
+        return phase == DONE;
+    }
+
+    bool step(unsigned int budget = 64) {
+        /*! Perform a part of the computation
+        @param budget Maximum number of operations (butterflies or samples) to process
+        @return true, if the computation is finished
+        */
+        while (budget && busy()) {
+            switch (phase) {
+            case WINDOW:
+                budget = applyWindow(budget);
+                break;
+            case BITREV:
+                budget = bitReverse(budget);
+                break;
+            case BUTTERFLY:
+                budget = butterflies(budget);
+                break;
+            case SPLIT:
+                budget = split(budget);
+                break;
+            default:
+                break;
+            }
+        }
+        return phase == DONE;
+    }
+
+    void compute(bool hannWindow = true) {
+        /*! Compute the power spectrum of the samples in the data buffer at once
+        @param hannWindow (optional, default true) Apply a Hann window to the samples
+        */
+        start(hannWindow);
+        while (!step(N)) {
+        }
+    }
+
+    T_FLOAT power(unsigned int k) const {
+        /*! Power of a frequency bin
+        @param k Bin index 0 .. N/2
+        @return Squared magnitude of the bin, not normalized
+        */
+        if (k == 0) {
+            return buf[0];
+        }
+        if (k >= M) {
+            return buf[1];
+        }
+        return buf[2 * k];
+    }
+
+    T_FLOAT bandRms(unsigned int kFrom, unsigned int kTo) const {
+        /*! RMS value of the signal components in a range of bins
+         *
+         * The result is corrected for the window, so that a sine wave with amplitude A
+         * within the band yields about A / sqrt(2).
+         *
+        @param kFrom First bin of the band
+        @param kTo Last bin of the band
+        @return RMS value of the band
+        */
+        T_FLOAT sum = 0;
+        for (unsigned int k = kFrom; k <= kTo && k <= M; k++) {
+            sum += (k == 0 || k == M) ? power(k) : 2 * power(k);
+        }
+        // the energy gain of the Hann window is 3/8
+        T_FLOAT norm = (T_FLOAT)N * (T_FLOAT)N * (windowed ? (T_FLOAT)0.375 : (T_FLOAT)1);
+        return (T_FLOAT)sqrt(sum / norm);
+    }
+
+  private:
+    T_FLOAT sinN(unsigned int k) const {
+        // sin(2 * pi * k / N) from the quarter wave table
+        k &= N - 1;
+        if (k <= N / 4) {
+            return sinTab[k];
+        }
+        if (k <= N / 2) {
+            return sinTab[N / 2 - k];
+        }
+        if (k <= 3 * N / 4) {
+            return -sinTab[k - N / 2];
+        }
+        return -sinTab[N - k];
+    }
+
+    T_FLOAT cosN(unsigned int k) const {
+        return sinN(k + N / 4);
+    }
+
+    unsigned int applyWindow(unsigned int budget) {
+        for (; budget && index < N; budget--, index++) {
+            buf[index] *= (T_FLOAT)0.5 - (T_FLOAT)0.5 * cosN(index);
+        }
+        if (index == N) {
+            phase = BITREV;
+            index = 0;
+        }
+        return budget;
+    }
+
+    unsigned int bitReverse(unsigned int budget) {
+        for (; budget && index < M; budget--, index++) {
+            unsigned int rev = 0;
+            for (unsigned int b = 1, r = M >> 1; b < M; b <<= 1, r >>= 1) {
+                if (index & b) {
+                    rev |= r;
+                }
+            }
+            if (index < rev) {
+                T_FLOAT t = buf[2 * index];
+                buf[2 * index] = buf[2 * rev];
+                buf[2 * rev] = t;
+                t = buf[2 * index + 1];
+                buf[2 * index + 1] = buf[2 * rev + 1];
+                buf[2 * rev + 1] = t;
+            }
+        }
+        if (index == M) {
+            phase = BUTTERFLY;
+            index = 0;
+            len = 2;
+        }
+        return budget;
+    }
+
+    unsigned int butterflies(unsigned int budget) {
+        // index counts the M/2 butterflies of the current stage
+        unsigned int half = len / 2;
+        unsigned int stride = N / len;
+        for (; budget && index < M / 2; budget--, index++) {
+            unsigned int j = index % half;
+            unsigned int a = 2 * ((index / half) * len + j);
+            unsigned int b = a + 2 * half;
+            T_FLOAT wr = cosN(j * stride);
+            T_FLOAT wi = -sinN(j * stride);
+            T_FLOAT tr = wr * buf[b] - wi * buf[b + 1];
+            T_FLOAT ti = wr * buf[b + 1] + wi * buf[b];
+            buf[b] = buf[a] - tr;
+            buf[b + 1] = buf[a + 1] - ti;
+            buf[a] += tr;
+            buf[a + 1] += ti;
+        }
+        if (index == M / 2) {
+            index = 0;
+            len <<= 1;
+            if (len > M) {
+                phase = SPLIT;
+            }
+        }
+        return budget;
+    }
+
+    unsigned int split(unsigned int budget) {
+        // separates the spectrum of the even and odd samples and stores the power of
+        // bin k in buf[2 * k], bin 0 in buf[0] and bin N/2 in buf[1]
+        if (index == 0) {
+            T_FLOAT r = buf[0], i = buf[1];
+            buf[0] = (r + i) * (r + i);
+            buf[1] = (r - i) * (r - i);
+            index = 1;
+            --budget;
+        }
+        for (; budget && index <= M / 2; budget--, index++) {
+            unsigned int k = index, m = M - index;
+            T_FLOAT zkr = buf[2 * k], zki = buf[2 * k + 1];
+            T_FLOAT zmr = buf[2 * m], zmi = buf[2 * m + 1];
+            buf[2 * k] = splitPower(zkr, zki, zmr, zmi, k);
+            if (m != k) {
+                buf[2 * m] = splitPower(zmr, zmi, zkr, zki, m);
+            }
+        }
+        if (index > M / 2) {
+            phase = DONE;
+        }
+        return budget;
+    }
+
+    T_FLOAT splitPower(T_FLOAT zkr, T_FLOAT zki, T_FLOAT zmr, T_FLOAT zmi, unsigned int k) const {
+        // X[k] = (Z[k] + conj(Z[M-k])) / 2 - i/2 * W^k * (Z[k] - conj(Z[M-k]))
+        T_FLOAT er = (zkr + zmr) / 2, ei = (zki - zmi) / 2;
+        T_FLOAT dr = (zkr - zmr) / 2, di = (zki + zmi) / 2;
+        // o = -i * d
+        T_FLOAT or_ = di, oi = -dr;
+        T_FLOAT wr = cosN(k), wi = -sinN(k);
+        T_FLOAT xr = er + wr * or_ - wi * oi;
+        T_FLOAT xi = ei + wr * oi + wi * or_;
+        return xr * xr + xi * xi;
+    }
+};
+
+/*! \brief muwerk SpectrumAnalyzer Class
+
+The SpectrumAnalyzer computes spectral features of a sampled signal on the node, e.g. for
+motor or vibration monitoring, and publishes only the features instead of the raw samples:
+
+* band RMS values of configurable frequency bands, computed with a \ref ustd::realFFT of N
+  samples (Hann windowed),
+* amplitudes of selected frequencies, computed with \ref ustd::goertzel filters while the
+  samples are acquired.
+
+Samples are collected with \ref addSample. When N samples are available, they are copied to
+the FFT buffer and the FFT is computed incrementally by a scheduler task: each pass of the
+task processes at most `budget` operations, so the computation is spread over many loop
+passes and never blocks other tasks. Frames that are completed while the previous FFT is
+still running are not analyzed and counted as `overruns`.
+
+Memory usage is about 2.25 * N values of T_FLOAT, plus the configured bands and bins.
+
+The following messages are published and supported:
+
+* publish: `name/spectrum` with a json object `{"bands":[rms,...],"bins":[amplitude,...]}`
+  after each analyzed frame.
+* subscribe: `name/spectrum/get` -> publishes the last result again.
+
+## Sample of a motor monitor:
+
+~~~{.cpp}
+#include <scheduler.h>
+#include <spectrum.h>
+
+ustd::Scheduler sched(10, 16, 32);
+ustd::SpectrumAnalyzer<512> motor("motor", 2000.0);  // 2 kHz sample rate
+
+void setup() {
+    motor.addBand(10, 100);   // unbalance
+    motor.addBand(100, 400);  // bearings
+    motor.addBin(50);         // mains hum
+    motor.begin(&sched);
+}
+
+void sampleTask() {
+    // called every 500us
+    motor.addSample(analogRead(A0));
+}
+~~~
+*/
+template <unsigned int N = 256, typename T_FLOAT = float> class SpectrumAnalyzer {
+  public:
+    String name;
+    T_FLOAT sampleRate;
+    unsigned int budget;
+
+    // statistics
+    unsigned long frames = 0;
+    unsigned long overruns = 0;
+
+  private:
+    typedef struct {
+        unsigned int kFrom;
+        unsigned int kTo;
+        T_FLOAT rms;
+    } T_BAND;
+
+    // muwerk task management
+    Scheduler *pSched = nullptr;
+    int tID = -1;
+
+    // acquisition and analysis
+    T_FLOAT acq[N];
+    unsigned int acqCount = 0;
+    realFFT<N, T_FLOAT> fft;
+    ustd::array<T_BAND> bands;
+    ustd::array<goertzel<T_FLOAT>> bins;
+    ustd::array<T_FLOAT> binAmplitudes;
+    bool bResult = false;
+
+  public:
+    SpectrumAnalyzer(String name, T_FLOAT sampleRate, unsigned int budget = 64)
+        : name(name), sampleRate(sampleRate), budget(budget), bands(4, 16), bins(4, 16),
+          binAmplitudes(4, 16) {
+        /*! Instantiates a SpectrumAnalyzer
+        @param name Name of the analyzer, used as task name and topic prefix
+        @param sampleRate Sample rate of the signal in Hz
+        @param budget (optional, default 64) Maximum number of FFT operations per loop pass
+        */
+    }
+
+    int addBand(T_FLOAT fFrom, T_FLOAT fTo) {
+        /*! Add a frequency band
+        @param fFrom Lower frequency of the band in Hz
+        @param fTo Upper frequency of the band in Hz
+        @return Index of the band in the published `bands` array, -1 on error
+        */
+        T_BAND band;
+        band.kFrom = (unsigned int)(fFrom * N / sampleRate + (T_FLOAT)0.5);
+        band.kTo = (unsigned int)(fTo * N / sampleRate + (T_FLOAT)0.5);
+        if (band.kTo > N / 2) {
+            band.kTo = N / 2;
+        }
+        if (band.kFrom > band.kTo) {
+            return -1;
+        }
+        band.rms = 0;
+        return bands.add(band);
+    }
+
+    int addBin(T_FLOAT frequency) {
+        /*! Add a frequency whose amplitude is measured with a Goertzel filter
+        @param frequency Frequency in Hz
+        @return Index of the frequency in the published `bins` array, -1 on error
+        */
+        int i = bins.add(goertzel<T_FLOAT>(frequency, sampleRate));
+        if (i >= 0) {
+            binAmplitudes[i] = 0;
+        }
+        return i;
+    }
+
+    void begin(Scheduler *_pSched, unsigned long minMicroSecs = 1000L) {
+        /*! Starts the SpectrumAnalyzer task
+        @param _pSched Pointer to the muwerk scheduler.
+        @param minMicroSecs (optional, default 1ms) Interval of the analysis task. Together
+        with the budget this determines the time needed for a FFT.
+        */
+        pSched = _pSched;
+        tID = pSched->add([this]() { this->loop(); }, name, minMicroSecs);
+        pSched->subscribe(tID, name + "/spectrum/get",
+                          [this](String topic, String msg, String originator) {
+                              if (this->bResult) {
+                                  this->publishResult();
+                              }
+                          });
+    }
+
+    void addSample(T_FLOAT sample) {
+        /*! Add a sample of the signal
+        @param sample The sample value
+        */
+        acq[acqCount++] = sample;
+        for (unsigned int i = 0; i < bins.length(); i++) {
+            bins[i].add(sample);
+        }
+        if (acqCount < N) {
+            return;
+        }
+        acqCount = 0;
+        for (unsigned int i = 0; i < bins.length(); i++) {
+            binAmplitudes[i] = bins[i].amplitude();
+            bins[i].reset();
+        }
+        if (fft.busy()) {
+            ++overruns;
+            return;
+        }
+        memcpy(fft.data(), acq, sizeof(acq));
+        fft.start();
+    }
+
+    T_FLOAT band(unsigned int index) {
+        /*! Get the RMS value of a band of the last analyzed frame
+        @param index Index of the band as returned by \ref addBand
+        @return RMS value of the band
+        */
+        return index < bands.length() ? bands[index].rms : 0;
+    }
+
+    T_FLOAT bin(unsigned int index) {
+        /*! Get the amplitude of a frequency of the last frame
+        @param index Index of the frequency as returned by \ref addBin
+        @return Amplitude of the frequency
+        */
+        return index < binAmplitudes.length() ? binAmplitudes[index] : 0;
+    }
+
+    void loop() {
+        /*! Continues the analysis of the current frame
+         *
+         * This is called by the scheduler, but can also be called directly if the analyzer
+         * is not started with \ref begin.
+         */
+        if (!fft.busy() || !fft.step(budget)) {
+            return;
+        }
+        for (unsigned int i = 0; i < bands.length(); i++) {
+            bands[i].rms = fft.bandRms(bands[i].kFrom, bands[i].kTo);
+        }
+        ++frames;
+        bResult = true;
+        publishResult();
+    }
+
+  private:
+    void publishResult() {
+        if (!pSched) {
+            return;
+        }
+        String json = "{\"bands\":[";
+        for (unsigned int i = 0; i < bands.length(); i++) {
+            json += (i ? "," : "") + format(bands[i].rms);
+        }
+        json += "],\"bins\":[";
+        for (unsigned int i = 0; i < binAmplitudes.length(); i++) {
+            json += (i ? "," : "") + format(binAmplitudes[i]);
+        }
+        json += "]}";
+        pSched->publish(name + "/spectrum", json);
+    }
+
+    static String format(T_FLOAT val) {
+        // json has no representation for nan and inf
+        if (val != val || val - val != 0) {
+            return "null";
+        }
+#if defined(__UNIXOID__) || defined(__RP_PICO__)
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%.4g", (double)val);
+        return buf;
+#else
+        return String((double)val, 4);
+#endif
+    }
+};  // SpectrumAnalyzer
+
+}  // namespace ustd
@@ -0,0 +1,174 @@
+// thresholddetector.h - muwerk threshold event detector
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "scheduler.h"
+
+namespace ustd {
+
+/*! \brief muwerk ThresholdDetector Class
+
+The ThresholdDetector watches a stream of sensor values (e.g. the output of a \ref
+ustd::sensorprocessor or a \ref ustd::SensorPipeline) and publishes only edge events when
+the value crosses a threshold. Consumers that only need to know whether a limit is exceeded
+subscribe to the events instead of parsing every value.
+
+The detector is configured by two levels:
+
+* `onLevel`: the state changes to `on`, when the value reaches this level
+* `offLevel`: the state changes back to `off`, when the value reaches this level
+
+If `onLevel` is greater than `offLevel`, the detector is a high limit detector (`on` if the
+value is >= `onLevel`), otherwise a low limit detector (`on` if the value is <= `onLevel`).
+The difference between both levels is the hysteresis. Optionally, a dwell time can be
+configured: a state change is only published, if the condition persists for at least that
+time.
+
+The following messages are published and supported:
+
+* publish: `name/<eventTopic>` with message `on` or `off` on each state change.
+* subscribe: `name/<eventTopic>/get` -> publishes the current state to `name/<eventTopic>`.
+
+## Sample of an over-temperature alarm:
+
+~~~{.cpp}
+#include <scheduler.h>
+#include <thresholddetector.h>
+
+ustd::Scheduler sched(10, 16, 32);
+
+// alarm on at 30°C, off below 28°C, condition must persist for 10 seconds
+ustd::ThresholdDetector<> tempAlarm("sensor/temp", 30.0, 28.0, 10000, "alarm");
+
+void setup() {
+    // watch the values published by the temperature sensor
+    tempAlarm.begin(&sched, "sensor/temp/value");
+}
+~~~
+
+Subscribers of `sensor/temp/alarm` receive `on` and `off` messages only.
+*/
+template <typename T_VALUE = double> class ThresholdDetector {
+  public:
+    String name;
+    String eventTopic;
+    T_VALUE onLevel;
+    T_VALUE offLevel;
+    unsigned long dwellMs;
+
+    // statistics
+    unsigned long values = 0;
+    unsigned long events = 0;
+
+  private:
+    // muwerk task management
+    Scheduler *pSched = nullptr;
+    int tID = -1;
+
+    // runtime state
+    bool state = false;
+    bool pending = false;
+    unsigned long pendingSince = 0;
+
+  public:
+    ThresholdDetector(String name, T_VALUE onLevel, T_VALUE offLevel, unsigned long dwellMs = 0,
+                      String eventTopic = "alarm")
+        : name(name), eventTopic(eventTopic), onLevel(onLevel), offLevel(offLevel),
+          dwellMs(dwellMs) {
+        /*! Instantiates a ThresholdDetector
+        @param name Name of the detector, used as task name and topic prefix
+        @param onLevel Level that switches the state to `on`
+        @param offLevel Level that switches the state back to `off`
+        @param dwellMs (optional, default 0) Time in milliseconds a condition must persist
+        before the state changes
+        @param eventTopic (optional, default `alarm`) Topic below name for publishing events
+        */
+    }
+
+    void begin(Scheduler *_pSched, String sourceTopic = "") {
+        /*! Starts the ThresholdDetector
+        @param _pSched Pointer to the muwerk scheduler.
+        @param sourceTopic (optional) Topic of messages containing numeric values that are
+        checked by the detector. Alternatively values can be passed directly with \ref update.
+        */
+        pSched = _pSched;
+        // sensor values are often published on change only, so expired dwell times must be
+        // checked periodically: with a resolution of 1/10 of the dwell time, at least every
+        // second. Without dwell time the task function is never called.
+        // clamped before multiplying, long dwell times would overflow 32 bit
+        unsigned long interval = dwellMs >= 10000 ? 1000000L : dwellMs * 100L;
+        tID = pSched->add([this]() { this->loop(); }, name, interval);
+        pSched->subscribe(tID, name + "/" + eventTopic + "/get",
+                          [this](String topic, String msg, String originator) {
+                              this->publishState();
+                          });
+        if (sourceTopic != "") {
+            pSched->subscribe(tID, sourceTopic,
+                              [this](String topic, String msg, String originator) {
+                                  this->update((T_VALUE)atof(msg.c_str()));
+                              });
+        }
+    }
+
+    bool update(T_VALUE value) {
+        /*! Check a new value
+        @param value The new sensor value
+        @return true, if the state has changed
+        */
+        ++values;
+        bool active = state ? !reached(value, offLevel, onLevel < offLevel)
+                            : reached(value, onLevel, onLevel >= offLevel);
+        if (active == state) {
+            pending = false;
+            return false;
+        }
+        if (!pending) {
+            pending = true;
+            pendingSince = millis();
+        }
+        return checkDwell();
+    }
+
+    bool getState() const {
+        /*! Get the current state
+        @return true, if the state is `on`
+        */
+        return state;
+    }
+
+    void loop() {
+        /*! Checks pending state changes whose dwell time has expired
+         *
+         * This is called by the scheduler, but can also be called directly if the detector
+         * is not started with \ref begin.
+         */
+        if (pending) {
+            checkDwell();
+        }
+    }
+
+  private:
+    static bool reached(T_VALUE value, T_VALUE level, bool upwards) {
+        return upwards ? value >= level : value <= level;
+    }
+
+    bool checkDwell() {
+        if (timeDiff(pendingSince, millis()) < dwellMs) {
+            return false;
+        }
+        pending = false;
+        state = !state;
+        ++events;
+        publishState();
+        return true;
+    }
+
+    void publishState() {
+        if (pSched) {
+            pSched->publish(name + "/" + eventTopic, state ? "on" : "off");
+        }
+    }
+};  // ThresholdDetector
+
+}  // namespace ustd
@@ -0,0 +1,564 @@
+// timeseries.h - muwerk compressed time series store
+
+#pragma once
+
+#include "ustd_platform.h"
+#include "muwerk.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef USTD_FEATURE_FILESYSTEM
+#include "ustd_functional.h"
+#include "filesystem.h"
+#include <functional>
+#endif
+
+#ifndef TIMESERIES_READ_CHUNK
+#define TIMESERIES_READ_CHUNK 64
+#endif
+
+namespace ustd {
+
+/*! \brief muwerk Time Series Block Encoder
+
+Encodes timestamped float values into a fixed size block using the compression scheme
+introduced by Facebook's Gorilla time series database:
+
+* Timestamps (in seconds) are stored as delta-of-delta with a variable length prefix code.
+  Regularly sampled values need a single bit per timestamp.
+* Values are XOR-ed with their predecessor, only the meaningful bits between the leading and
+  trailing zeros are stored. Unchanged values need a single bit.
+
+Typical sensor data compresses to 1-3 bytes per sample, compared to 8 bytes for the raw
+binary representation and about 20 bytes for a text or json log line.
+
+Block layout (little endian): `uint16 count`, `uint16 bits` (payload length in bits),
+`uint32 t0`, `uint32 v0` (raw bits of the first value), followed by the bit stream payload.
+Unused bytes at the end of a block are zero.
+*/
+template <unsigned int BLOCK_SIZE = 256> class tsBlockEncoder {
+  public:
+    static const unsigned int headerSize = 12;  //!< Size of the block header in bytes
+    uint8_t data[BLOCK_SIZE];                     //!< The encoded block
+
+  private:
+    static const unsigned int maxSampleBits = 4 + 32 + 2 + 5 + 5 + 32;
+    // the payload length in bits is stored as uint16 in the header
+    static_assert(BLOCK_SIZE >= headerSize + (maxSampleBits + 7) / 8 && BLOCK_SIZE <= 8192,
+                  "BLOCK_SIZE must be between 22 and 8192 bytes");
+    unsigned int count;
+    unsigned int bitPos;
+    uint32_t prevT;
+    uint32_t prevDelta;
+    uint32_t prevV;
+    uint8_t prevLead;
+    uint8_t prevTrail;
+
+  public:
+    tsBlockEncoder() {
+        /*! Instantiates an empty block encoder */
+        reset();
+    }
+
+    void reset() {
+        //! Clears the block
+        memset(data, 0, BLOCK_SIZE);
+        count = 0;
+        bitPos = 0;
+        prevLead = 0xff;
+        prevTrail = 0;
+    }
+
+    unsigned int length() const {
+        /*! Number of samples in the block
+        @return Number of samples
+        */
+        return count;
+    }
+
+    unsigned int bytes() const {
+        /*! Number of bytes used by the block
+        @return Used bytes including the header
+        */
+        return count ? headerSize + (bitPos + 7) / 8 : 0;
+    }
+
+    bool add(uint32_t t, float value) {
+        /*! Adds a sample to the block
+        @param t Timestamp in seconds, timestamps should not decrease
+        @param value Sample value
+        @return false, if the block is full. The sample is not added in this case.
+        */
+        uint32_t v;
+        memcpy(&v, &value, sizeof(v));
+        if (!count) {
+            put16(0, 1);
+            put32(4, t);
+            put32(8, v);
+            count = 1;
+            prevT = t;
+            prevDelta = 0;
+            prevV = v;
+            return true;
+        }
+        if (bitPos + maxSampleBits > (BLOCK_SIZE - headerSize) * 8) {
+            return false;
+        }
+        uint32_t delta = t - prevT;
+        int32_t dod = (int32_t)(delta - prevDelta);
+        if (dod == 0) {
+            writeBits(0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            writeBits(0x2, 2);
+            writeBits((uint32_t)dod & 0x7f, 7);
+        } else if (dod >= -255 && dod <= 256) {
+            writeBits(0x6, 3);
+            writeBits((uint32_t)dod & 0x1ff, 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            writeBits(0xe, 4);
+            writeBits((uint32_t)dod & 0xfff, 12);
+        } else {
+            writeBits(0xf, 4);
+            writeBits((uint32_t)dod, 32);
+        }
+        prevT = t;
+        prevDelta = delta;
+
+        uint32_t x = v ^ prevV;
+        prevV = v;
+        if (!x) {
+            writeBits(0, 1);
+        } else {
+            uint8_t lead = leadingZeros(x);
+            uint8_t trail = (uint8_t)__builtin_ctzl(x);
+            if (lead > 31) {
+                lead = 31;
+            }
+            if (prevLead != 0xff && lead >= prevLead && trail >= prevTrail) {
+                writeBits(0x2, 2);
+                writeBits(x >> prevTrail, 32 - prevLead - prevTrail);
+            } else {
+                uint8_t meaningful = 32 - lead - trail;
+                writeBits(0x3, 2);
+                writeBits(lead, 5);
+                writeBits(meaningful - 1, 5);
+                writeBits(x >> trail, meaningful);
+                prevLead = lead;
+                prevTrail = trail;
+            }
+        }
+        ++count;
+        put16(0, (uint16_t)count);
+        put16(2, (uint16_t)bitPos);
+        return true;
+    }
+
+  private:
+    static uint8_t leadingZeros(uint32_t x) {
+        // __builtin_clz() takes an unsigned int, which has only 16 bits on AVR
+        return (uint8_t)(__builtin_clzl(x) - (sizeof(unsigned long) - sizeof(uint32_t)) * 8);
+    }
+
+    void put16(unsigned int pos, uint16_t val) {
+        data[pos] = (uint8_t)val;
+        data[pos + 1] = (uint8_t)(val >> 8);
+    }
+
+    void put32(unsigned int pos, uint32_t val) {
+        put16(pos, (uint16_t)val);
+        put16(pos + 2, (uint16_t)(val >> 16));
+    }
+
+    void writeBits(uint32_t val, uint8_t nbits) {
+        while (nbits) {
+            uint8_t *p = data + headerSize + bitPos / 8;
+            uint8_t free = 8 - bitPos % 8;
+            uint8_t n = nbits < free ? nbits : free;
+            uint8_t chunk = (uint8_t)((val >> (nbits - n)) & ((1u << n) - 1));
+            *p |= (uint8_t)(chunk << (free - n));
+            bitPos += n;
+            nbits -= n;
+        }
+    }
+};  // tsBlockEncoder
+
+/*! \brief muwerk Time Series Block Decoder
+
+Streaming decoder for blocks generated by \ref ustd::tsBlockEncoder. The decoder does not copy
+the block and keeps only a few bytes of state, samples are decoded one by one with \ref next.
+The block does not need to be in memory completely: with \ref consumed and \ref rebase, the
+payload can be supplied through a small window (see \ref ustd::TimeSeriesStore::read).
+
+~~~{.cpp}
+ustd::tsBlockDecoder dec(block);
+uint32_t t;
+float value;
+while (dec.next(&t, &value)) {
+    // process sample
+}
+~~~
+*/
+class tsBlockDecoder {
+  public:
+    static const unsigned int headerSize = 12;  //!< Size of the block header in bytes
+    //! Maximum number of payload bytes touched by the next sample, starting at \ref consumed
+    static const unsigned int maxSampleBytes = 11;
+
+  private:
+    const uint8_t *data;
+    uint32_t t0;
+    uint32_t v0;
+    unsigned int count;
+    unsigned int index;
+    unsigned int bitPos;
+    uint32_t prevT;
+    uint32_t prevDelta;
+    uint32_t prevV;
+    uint8_t prevLead;
+    uint8_t prevTrail;
+
+  public:
+    tsBlockDecoder(const uint8_t *block) : data(block + headerSize) {
+        /*! Instantiates a decoder for a block
+        @param block Pointer to the encoded block, must stay valid while decoding. At least the
+        header must be available, see \ref rebase.
+        */
+        count = block[0] | ((unsigned int)block[1] << 8);
+        t0 = get32(block + 4);
+        v0 = get32(block + 8);
+        index = 0;
+        bitPos = 0;
+        prevLead = 0;
+        prevTrail = 0;
+    }
+
+    unsigned int length() const {
+        /*! Number of samples in the block
+        @return Number of samples
+        */
+        return count;
+    }
+
+    uint32_t startTime() const {
+        /*! Timestamp of the first sample in the block
+        @return Timestamp in seconds
+        */
+        return t0;
+    }
+
+    unsigned int consumed() const {
+        /*! Number of payload bytes that are completely decoded
+        @return Offset of the first payload byte needed by \ref next
+        */
+        return bitPos / 8;
+    }
+
+    void rebase(const uint8_t *payload) {
+        /*! Continue decoding from another buffer
+        @param payload Pointer to the payload byte at offset \ref consumed, at least \ref
+        maxSampleBytes bytes (or up to the end of the block) must be available there
+        */
+        data = payload;
+        bitPos %= 8;
+    }
+
+    bool next(uint32_t *pT, float *pValue) {
+        /*! Decodes the next sample of the block
+        @param pT Receives the timestamp
+        @param pValue Receives the value
+        @return false, if there are no more samples
+        */
+        if (index >= count) {
+            return false;
+        }
+        if (!index) {
+            prevT = t0;
+            prevV = v0;
+            prevDelta = 0;
+        } else {
+            int32_t dod;
+            if (!readBits(1)) {
+                dod = 0;
+            } else if (!readBits(1)) {
+                dod = signExtend(readBits(7), 7);
+            } else if (!readBits(1)) {
+                dod = signExtend(readBits(9), 9);
+            } else if (!readBits(1)) {
+                dod = signExtend(readBits(12), 12);
+            } else {
+                dod = (int32_t)readBits(32);
+            }
+            prevDelta += (uint32_t)dod;
+            prevT += prevDelta;
+            if (readBits(1)) {
+                if (readBits(1)) {
+                    prevLead = (uint8_t)readBits(5);
+                    uint8_t meaningful = (uint8_t)readBits(5) + 1;
+                    prevTrail = 32 - prevLead - meaningful;
+                }
+                prevV ^= readBits(32 - prevLead - prevTrail) << prevTrail;
+            }
+        }
+        ++index;
+        *pT = prevT;
+        memcpy(pValue, &prevV, sizeof(prevV));
+        return true;
+    }
+
+  private:
+    static uint32_t get32(const uint8_t *p) {
+        return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static int32_t signExtend(uint32_t val, uint8_t nbits) {
+        // the encoded ranges are asymmetric: -(2^(n-1)-1) .. 2^(n-1)
+        if (val > (1u << (nbits - 1))) {
+            return (int32_t)val - (int32_t)(1u << nbits);
+        }
+        return (int32_t)val;
+    }
+
+    uint32_t readBits(uint8_t nbits) {
+        uint32_t val = 0;
+        while (nbits) {
+            const uint8_t *p = data + bitPos / 8;
+            uint8_t avail = 8 - bitPos % 8;
+            uint8_t n = nbits < avail ? nbits : avail;
+            val = (val << n) | ((*p >> (avail - n)) & ((1u << n) - 1));
+            bitPos += n;
+            nbits -= n;
+        }
+        return val;
+    }
+};  // tsBlockDecoder
+
+#ifdef USTD_FEATURE_FILESYSTEM
+
+/*! \brief muwerk Time Series Store
+
+Persists timestamped float values compressed with \ref ustd::tsBlockEncoder to the flash
+filesystem. Samples are collected in a RAM block of BLOCK_SIZE bytes, which is appended to
+the file only when it is full. Choosing BLOCK_SIZE as a multiple of the filesystem page size
+minimizes write amplification and erase cycles.
+
+The history is kept in two files, `<filename>.0` and `<filename>.1`, of at most
+`maxBlocks` blocks each. When the active file is full, the older one is deleted and reused,
+so that the store always holds between `maxBlocks` and `2 * maxBlocks` blocks.
+
+~~~{.cpp}
+#include <timeseries.h>
+
+ustd::TimeSeriesStore<512> tempLog("/temperature", 32);
+
+void setup() {
+    tempLog.begin();
+}
+
+void logTemperature(float value) {
+    tempLog.add(value, time(nullptr));
+}
+
+void dumpLastHour() {
+    tempLog.read(time(nullptr) - 3600, 0xffffffff, [](uint32_t t, float value) {
+        Serial.println(String(t) + ": " + String(value));
+    });
+}
+~~~
+*/
+template <unsigned int BLOCK_SIZE = 256> class TimeSeriesStore {
+  public:
+    //! \brief Callback for reading samples
+#if defined(__ESP__) || defined(__ESP32__) || defined(__UNIXOID__) || defined(__RP_PICO__)
+    typedef std::function<void(uint32_t t, float value)> T_READER;
+#elif defined(__ATTINY__)
+    typedef void (*T_READER)(uint32_t t, float value);
+#else
+    typedef ustd::function<void(uint32_t t, float value)> T_READER;
+#endif
+
+    String filename;
+    unsigned int maxBlocks;
+
+  private:
+    tsBlockEncoder<BLOCK_SIZE> block;
+    int active = 0;
+
+  public:
+    TimeSeriesStore(String filename, unsigned int maxBlocks = 16)
+        : filename(filename), maxBlocks(maxBlocks) {
+        /*! Instantiates a time series store
+        @param filename Absolute base filename, the suffixes `.0` and `.1` are appended
+        @param maxBlocks (optional, default 16) Maximum number of blocks per file
+        */
+    }
+
+    void begin() {
+        /*! Determines the active file. Call this once before adding samples. */
+        uint32_t t0 = startTime(0), t1 = startTime(1);
+        active = (blocks(1) && (!blocks(0) || t1 > t0)) ? 1 : 0;
+    }
+
+    bool add(float value, uint32_t t = 0) {
+        /*! Adds a sample to the store
+        @param value Sample value
+        @param t (optional) Timestamp in seconds, default is the number of seconds since startup.
+        @return false, if a full block could not be written to the filesystem. The sample is
+        not added in this case, the block is kept and written by the next call of add() or
+        \ref flush().
+        */
+        if (!t) {
+            t = (uint32_t)(millis() / 1000);
+        }
+        if (block.add(t, value)) {
+            return true;
+        }
+        if (!writeBlock()) {
+            return false;
+        }
+        block.add(t, value);
+        return true;
+    }
+
+    bool flush() {
+        /*! Writes the current, partially filled block to the filesystem
+         *
+         * Since blocks are always written in full size, flushing wastes the remaining space of
+         * the block. Use this only before shutdown or deep sleep.
+         * @return false on filesystem error
+         */
+        return block.length() ? writeBlock() : true;
+    }
+
+    void read(uint32_t from, uint32_t to, T_READER reader) {
+        /*! Streams all samples in a time range, oldest first
+        @param from Start of the range in seconds
+        @param to End of the range in seconds
+        @param reader Callback that receives the samples
+        */
+        int idx[2] = {1 - active, active};
+        for (int i = 0; i < 2; i++) {
+            fs::File f = openFile(idx[i], "r");
+            if (!f) {
+                continue;
+            }
+            unsigned int n = f.size() / BLOCK_SIZE;
+            for (unsigned int b = 0; b < n; b++) {
+                if (!f.seek(b * BLOCK_SIZE) || !decodeFileBlock(f, from, to, reader)) {
+                    f.close();
+                    return;
+                }
+            }
+            f.close();
+        }
+        tsBlockDecoder dec(block.data);
+        decodeSamples(dec, from, to, reader);
+    }
+
+  private:
+    String fileName(int index) {
+        return filename + (index ? ".1" : ".0");
+    }
+
+    fs::File openFile(int index, String mode) {
+        return fsOpen(fileName(index), mode);
+    }
+
+    unsigned int blocks(int index) {
+        fs::File f = openFile(index, "r");
+        if (!f) {
+            return 0;
+        }
+        unsigned int n = f.size() / BLOCK_SIZE;
+        f.close();
+        return n;
+    }
+
+    uint32_t startTime(int index) {
+        uint8_t header[tsBlockEncoder<BLOCK_SIZE>::headerSize];
+        fs::File f = openFile(index, "r");
+        if (!f) {
+            return 0;
+        }
+        bool ok = f.read(header, sizeof(header)) == sizeof(header);
+        f.close();
+        return ok ? tsBlockDecoder(header).startTime() : 0;
+    }
+
+    bool writeBlock() {
+        if (blocks(active) >= maxBlocks) {
+            active = 1 - active;
+            fsDelete(fileName(active));
+        }
+        fs::File f = openFile(active, fsExists(fileName(active)) ? "r+" : "w");
+        if (!f) {
+            return false;
+        }
+        // a partial block left by a failed write is overwritten
+        unsigned int pos = f.size() / BLOCK_SIZE * BLOCK_SIZE;
+        bool ret = f.seek(pos) && f.write(block.data, BLOCK_SIZE) == BLOCK_SIZE;
+        f.close();
+        if (ret) {
+            block.reset();
+        }
+        return ret;
+    }
+
+    static bool decodeFileBlock(fs::File &f, uint32_t from, uint32_t to, T_READER &reader) {
+        // the block is read through a window, so large blocks do not need stack space
+        static const unsigned int chunk =
+            BLOCK_SIZE < TIMESERIES_READ_CHUNK ? BLOCK_SIZE : TIMESERIES_READ_CHUNK;
+        static const unsigned int minChunk =
+            2 * (tsBlockDecoder::headerSize + tsBlockDecoder::maxSampleBytes);
+        static_assert(chunk == BLOCK_SIZE || chunk >= minChunk, "TIMESERIES_READ_CHUNK too small");
+        uint8_t buf[chunk];
+        if (f.read(buf, chunk) != chunk) {
+            return false;
+        }
+        tsBlockDecoder dec(buf);
+        return decodeSamples(dec, from, to, reader, &f, buf, BLOCK_SIZE - chunk);
+    }
+
+    static bool decodeSamples(tsBlockDecoder &dec, uint32_t from, uint32_t to, T_READER &reader,
+                              fs::File *pFile = nullptr, uint8_t *buf = nullptr,
+                              unsigned int left = 0) {
+        // left: bytes of the block that are still in the file, the window is buf
+        static const unsigned int chunk =
+            BLOCK_SIZE < TIMESERIES_READ_CHUNK ? BLOCK_SIZE : TIMESERIES_READ_CHUNK;
+        unsigned int offset = tsBlockDecoder::headerSize;
+        unsigned int payloadLen = chunk - tsBlockDecoder::headerSize;
+        if (dec.length() && dec.startTime() > to) {
+            return false;
+        }
+        uint32_t t;
+        float value;
+        while (true) {
+            if (left && dec.consumed() + tsBlockDecoder::maxSampleBytes > payloadLen) {
+                // move the undecoded rest to the start of the window and refill it
+                unsigned int keep = payloadLen - dec.consumed();
+                memmove(buf, buf + offset + dec.consumed(), keep);
+                unsigned int n = chunk - keep < left ? chunk - keep : left;
+                if (pFile->read(buf + keep, n) != n) {
+                    return false;
+                }
+                left -= n;
+                offset = 0;
+                payloadLen = keep + n;
+                dec.rebase(buf);
+            }
+            if (!dec.next(&t, &value)) {
+                return true;
+            }
+            if (t > to) {
+                return false;
+            }
+            if (t >= from) {
+                reader(t, value);
+            }
+        }
+    }
+};  // TimeSeriesStore
+
+#endif  // USTD_FEATURE_FILESYSTEM
+
+}  // namespace ustd